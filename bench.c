@@ -0,0 +1,298 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements gol_bench, which times the game on random boards
+ * made from a seed, so that two builds can be compared on exactly the
+ * same work. For every partition mode and thread count asked for, it
+ * plays some warm-up games that are not counted, then the timed trials,
+ * and reports the median and spread of the trial times, cells updated
+ * per second, and the speedup and parallel efficiency over the smallest
+ * thread count. Results are written as CSV or JSON.
+ *
+ * To run:
+ * ./gol_bench                          # 2048x2048, 100 rounds, 1..CPUs
+ * ./gol_bench -r 4096 -c 4096 -T 1,2,4,8 -m 0,1,2 -f json -o out.json
+ *
+ * Options:
+ *   -r rows -c cols -i rounds   board size and rounds per game
+ *   -d density    chance that a cell starts out alive (default 0.3)
+ *   -S seed       seed for the board (default 1)
+ *   -T list       thread counts, comma separated (default 1, 2, 4, ...
+ *                 up to the number of CPUs)
+ *   -m list       partition modes, comma separated (default 0,1)
+ *   -w n          warm-up games per setting (default 1)
+ *   -n n          timed games per setting (default 5)
+ *   -k kernel     as for gol
+ *   -R rule       as for gol
+ *   -t steps      as for gol
+ *   -f format     csv (default) or json
+ *   -o file       write the results to file instead of stdout
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "gol.h"
+
+/* Most thread counts or partition modes a list may hold */
+#define MAX_LIST       (64)
+
+/* The results for one partition mode and thread count */
+struct bench_row {
+    int mode;
+    int threads;
+    double median;  // seconds per game
+    double p10;
+    double p90;
+    double min;
+    double max;
+    double rate;    // cells updated per second, at the median
+    double speedup; // over the smallest thread count in the same mode
+    double efficiency;
+    int live;
+};
+
+/* This function reads a comma separated list of integers.
+ * param arg: the list
+ * param list: where the integers go, MAX_LIST of them at most
+ * returns the number of integers */
+static int parse_list(const char *arg, int *list){
+    char *end;
+    int n = 0;
+
+    while (*arg){
+        if (n == MAX_LIST){
+            printf("At most %d values in a list.\n", MAX_LIST);
+            exit(1);
+        }
+        list[n++] = (int)strtol(arg, &end, 10);
+        if (end == arg || (*end != ',' && *end != '\0')){
+            printf("Bad list: %s\n", arg);
+            exit(1);
+        }
+        arg = (*end == ',') ? end + 1 : end;
+    }
+    return n;
+}
+
+static int compare_doubles(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* This function finds a percentile of sorted times, interpolating
+ * between the two nearest trials.
+ * param times: n times, sorted
+ * param pct: percentile, from 0 to 100
+ * returns the percentile */
+static double percentile(const double *times, int n, double pct){
+    double at = pct/100*(n - 1);
+    int i = (int)at;
+
+    if (i >= n - 1){
+        return times[n - 1];
+    }
+    return times[i] + (at - i)*(times[i + 1] - times[i]);
+}
+
+/* This function plays the warm-up and timed games for one setting.
+ * param game: the settings, with threads and divide_mode filled in
+ * param warmups, trials: number of games of each
+ * param row: filled in with the results (but not the speedup) */
+static void run_setting(struct gol_bench *game, int warmups, int trials,
+        struct bench_row *row){
+    double *times = malloc(sizeof(double)*trials);
+    int live = -1;
+
+    if (!times){
+        perror("malloc: times");
+        exit(1);
+    }
+    for (int i = 0; i < warmups + trials; i++){
+        gol_bench_run(game);
+        //every game is on the same board, so they must all agree
+        if (live >= 0 && game->live != live){
+            printf("Games on the same board ended with %d and %d live"\
+                    " cells (mode %d, %d threads).\n", live, game->live,
+                    game->divide_mode, game->threads);
+            exit(1);
+        }
+        live = game->live;
+        if (i >= warmups){
+            times[i - warmups] = game->secs;
+        }
+    }
+    qsort(times, trials, sizeof(double), compare_doubles);
+
+    row->mode = game->divide_mode;
+    row->threads = game->threads;
+    row->median = percentile(times, trials, 50);
+    row->p10 = percentile(times, trials, 10);
+    row->p90 = percentile(times, trials, 90);
+    row->min = times[0];
+    row->max = times[trials - 1];
+    row->rate = (row->median > 0) ? (double)game->rows*game->cols*
+        game->iters/row->median : 0;
+    row->live = live;
+    free(times);
+}
+
+static void write_csv(FILE *out, struct gol_bench *game, int trials,
+        struct bench_row *rows, int n){
+    fprintf(out, "mode,threads,rows,cols,rounds,density,seed,kernel,"\
+            "rule,trials,median_s,p10_s,p90_s,min_s,max_s,cells_per_s,"\
+            "speedup,efficiency,live\n");
+    for (int i = 0; i < n; i++){
+        fprintf(out, "%d,%d,%d,%d,%d,%g,%lu,%s,%s,%d,%.6f,%.6f,%.6f,%.6f,"\
+                "%.6f,%.4e,%.3f,%.3f,%d\n", rows[i].mode, rows[i].threads,
+                game->rows, game->cols, game->iters, game->density,
+                game->seed, game->kernel_name,
+                game->rule ? game->rule : "B3/S23", trials, rows[i].median,
+                rows[i].p10, rows[i].p90, rows[i].min, rows[i].max,
+                rows[i].rate, rows[i].speedup, rows[i].efficiency,
+                rows[i].live);
+    }
+}
+
+static void write_json(FILE *out, struct gol_bench *game, int warmups,
+        int trials, struct bench_row *rows, int n){
+    fprintf(out, "{\n  \"rows\": %d,\n  \"cols\": %d,\n  \"rounds\": %d,\n"\
+            "  \"density\": %g,\n  \"seed\": %lu,\n  \"kernel\": \"%s\",\n"\
+            "  \"rule\": \"%s\",\n"\
+            "  \"steps\": %d,\n  \"warmups\": %d,\n  \"trials\": %d,\n"\
+            "  \"results\": [\n", game->rows, game->cols, game->iters,
+            game->density, game->seed, game->kernel_name,
+            game->rule ? game->rule : "B3/S23", game->steps,
+            warmups, trials);
+    for (int i = 0; i < n; i++){
+        fprintf(out, "    {\"mode\": %d, \"threads\": %d, "\
+                "\"median_s\": %.6f, \"p10_s\": %.6f, \"p90_s\": %.6f, "\
+                "\"min_s\": %.6f, \"max_s\": %.6f, \"cells_per_s\": %.4e, "\
+                "\"speedup\": %.3f, \"efficiency\": %.3f, \"live\": %d}%s\n",
+                rows[i].mode, rows[i].threads, rows[i].median, rows[i].p10,
+                rows[i].p90, rows[i].min, rows[i].max, rows[i].rate,
+                rows[i].speedup, rows[i].efficiency, rows[i].live,
+                (i < n - 1) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char **argv){
+    struct gol_bench game;
+    struct bench_row *rows;
+    int threads[MAX_LIST], modes[MAX_LIST];
+    int num_threads = 0, num_modes = 2, warmups = 1, trials = 5;
+    int n = 0, cpus, opt, json = 0;
+    const char *path = NULL;
+    FILE *out = stdout;
+
+    memset(&game, 0, sizeof(game));
+    game.rows = 2048;
+    game.cols = 2048;
+    game.iters = 100;
+    game.density = 0.3;
+    game.seed = 1;
+    game.steps = 1;
+    modes[0] = 0;
+    modes[1] = 1;
+
+    while ((opt = getopt(argc, argv, "r:c:i:d:S:T:m:w:n:k:R:t:f:o:")) != -1){
+        switch (opt){
+            case 'r': game.rows = atoi(optarg); break;
+            case 'c': game.cols = atoi(optarg); break;
+            case 'i': game.iters = atoi(optarg); break;
+            case 'd': game.density = atof(optarg); break;
+            case 'S': game.seed = strtoul(optarg, NULL, 10); break;
+            case 'T': num_threads = parse_list(optarg, threads); break;
+            case 'm': num_modes = parse_list(optarg, modes); break;
+            case 'w': warmups = atoi(optarg); break;
+            case 'n': trials = atoi(optarg); break;
+            case 'k': game.kernel = optarg; break;
+            case 'R': game.rule = optarg; break;
+            case 't': game.steps = atoi(optarg); break;
+            case 'f':
+                if (strcmp(optarg, "json") == 0){
+                    json = 1;
+                } else if (strcmp(optarg, "csv") != 0){
+                    printf("Unknown format: %s (options are csv, json)\n",
+                            optarg);
+                    exit(1);
+                }
+                break;
+            case 'o': path = optarg; break;
+            default:
+                printf("Usage: %s [-r rows] [-c cols] [-i rounds]"\
+                        " [-d density] [-S seed] [-T threads,...]"\
+                        " [-m modes,...] [-w warmups] [-n trials]"\
+                        " [-k kernel] [-R rule] [-t steps] [-f csv|json]"\
+                        " [-o file]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (trials < 1 || warmups < 0 || game.density < 0 || game.density > 1){
+        printf("Need at least 1 trial, no negative warm-ups, and a"\
+                " density from 0 to 1.\n");
+        exit(1);
+    }
+
+    //by default, powers of two up to the number of CPUs, and then the
+    //number of CPUs itself
+    if (num_threads == 0){
+        cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        for (int t = 1; t < cpus && num_threads < MAX_LIST - 1; t *= 2){
+            threads[num_threads++] = t;
+        }
+        threads[num_threads++] = cpus;
+    }
+
+    rows = malloc(sizeof(struct bench_row)*num_modes*num_threads);
+    if (!rows){
+        perror("malloc: results");
+        exit(1);
+    }
+
+    for (int m = 0; m < num_modes; m++){
+        int base = n;
+
+        for (int t = 0; t < num_threads; t++){
+            game.divide_mode = modes[m];
+            game.threads = threads[t];
+            run_setting(&game, warmups, trials, &rows[n]);
+            //the smallest thread count is the baseline
+            if (rows[n].threads < rows[base].threads){
+                base = n;
+            }
+            fprintf(stderr, "mode %d, %d threads: %.6f s\n", modes[m],
+                    threads[t], rows[n].median);
+            n++;
+        }
+        for (int i = n - num_threads; i < n; i++){
+            rows[i].speedup = (rows[i].median > 0) ?
+                rows[base].median/rows[i].median : 0;
+            rows[i].efficiency = rows[i].speedup*rows[base].threads/
+                rows[i].threads;
+        }
+    }
+
+    if (path){
+        out = fopen(path, "w");
+        if (!out){
+            printf("Error: failed to open file: %s\n", path);
+            exit(1);
+        }
+    }
+    if (json){
+        write_json(out, &game, warmups, trials, rows, n);
+    } else {
+        write_csv(out, &game, trials, rows, n);
+    }
+    if (path){
+        fclose(out);
+    }
+    free(rows);
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the frame writer (see frames.h). */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "frames.h"
+
+static const char *format_names[] = { "ppm", "pgm", "raw" };
+
+/* Where standard output went once frames_claim_stdout took it, or -1 */
+static int stdout_fd = -1;
+
+struct frames {
+    struct grid grid;
+    int format;
+    const char *path;   // a file per frame, NULL for one stream
+    int fd;             // the stream
+    int depth;          // bytes per pixel
+    size_t header;      // bytes before the pixels
+    size_t size;        // bytes in a frame, header and all
+    uint8_t *bufs[2];   // header and pixels of two frames
+    int written;        // frames written
+};
+
+/* This function finds the format called name.
+ * param name: ppm, pgm or raw
+ * returns FRAMES_PPM, FRAMES_PGM or FRAMES_RAW, or -1
+ */
+int frames_format(const char *name){
+    for (int i = 0; i <= FRAMES_RAW; i++){
+        if (strcmp(name, format_names[i]) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* This function takes standard output for frames, sending everything else
+ * the program prints there to standard error; it does nothing the
+ * second time.
+ */
+void frames_claim_stdout(void){
+    if (stdout_fd >= 0){
+        return;
+    }
+    fflush(stdout);
+    stdout_fd = dup(STDOUT_FILENO);
+    if (stdout_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0){
+        perror("dup: frames");
+        exit(1);
+    }
+}
+
+/* This function checks whether a path is a file name pattern: one %d,
+ * maybe with a 0 and a width (%05d), and no other %.
+ * param path: the path
+ * returns 1 if it is a pattern, 0 if it has no %, -1 if it's no good
+ */
+static int path_pattern(const char *path){
+    const char *p = strchr(path, '%');
+
+    if (p == NULL){
+        return 0;
+    }
+    p++;
+    while (*p >= '0' && *p <= '9'){
+        p++;
+    }
+    if (*p != 'd' || strchr(p, '%') != NULL){
+        return -1;
+    }
+    return 1;
+}
+
+/* This function writes all of a buffer, however many writes it takes.
+ * param fd: where to
+ * param buf, len: what to write
+ * returns 0, or -1 if a write failed
+ */
+static int write_all(int fd, const uint8_t *buf, size_t len){
+    ssize_t n;
+
+    while (len > 0){
+        n = write(fd, buf, len);
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* This function sets up to write frames.
+ * param g: the layout of the boards it will write
+ * param format: one of the FRAMES_ formats
+ * param path: a file name pattern with a %d, a file, or - for stdout
+ * returns the frame writer
+ */
+struct frames *frames_open(const struct grid *g, int format,
+        const char *path){
+    struct frames *f = calloc(1, sizeof(struct frames));
+    char header[64];
+    int pattern = path_pattern(path);
+
+    if (!f){
+        perror("calloc: frames");
+        exit(1);
+    }
+    if (pattern < 0){
+        printf("Frame path %s: a %% must be a %%d, and there can only"\
+                " be one.\n", path);
+        exit(1);
+    }
+    f->grid = *g;
+    f->format = format;
+    f->fd = -1;
+    if (pattern){
+        f->path = path;
+    } else if (strcmp(path, "-") == 0){
+        frames_claim_stdout();
+        f->fd = stdout_fd;
+        stdout_fd = -1;
+    } else {
+        f->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (f->fd < 0){
+            perror(path);
+            exit(1);
+        }
+    }
+
+    header[0] = '\0';
+    if (format != FRAMES_RAW){
+        sprintf(header, "P%d\n%d %d\n255\n", format == FRAMES_PGM ? 5 : 6,
+                g->cols, g->rows);
+    }
+    f->depth = (format == FRAMES_PGM) ? 1 : 3;
+    f->header = strlen(header);
+    f->size = f->header + (size_t)g->rows*g->cols*f->depth;
+    for (int i = 0; i < 2; i++){
+        f->bufs[i] = malloc(f->size);
+        if (!f->bufs[i]){
+            perror("malloc: frame");
+            exit(1);
+        }
+        memcpy(f->bufs[i], header, f->header);
+    }
+    return f;
+}
+
+/* This function encodes part of a board into a frame buffer.
+ * param f: the frame writer
+ * param buf: the frame buffer, 0 or 1
+ * param cells: the board
+ * param r0, r1, c0, c1: the part of the board, first and last row and
+ *        column
+ * param dead: the color of dead cells, red, green and blue (PPM and raw)
+ */
+void frames_encode(struct frames *f, int buf, uint64_t *cells, int r0,
+        int r1, int c0, int c1, const uint8_t *dead){
+    const struct grid *g = &f->grid;
+    const uint64_t *row;
+    uint8_t *px;
+    uint64_t word;
+    int r, c;
+
+    for (r = r0; r <= r1; r++){
+        row = grid_row(g, cells, r);
+        px = f->bufs[buf] + f->header + ((size_t)r*g->cols + c0)*f->depth;
+        word = row[c0/64] >> (c0%64);
+        for (c = c0; c <= c1; c++){
+            if (c%64 == 0){
+                word = row[c/64];
+            }
+            if (f->depth == 1){
+                *px++ = (word & 1) ? 0 : 255;
+            } else if (word & 1){
+                px[0] = px[1] = px[2] = 0;
+                px += 3;
+            } else {
+                px[0] = dead[0];
+                px[1] = dead[1];
+                px[2] = dead[2];
+                px += 3;
+            }
+            word >>= 1;
+        }
+    }
+}
+
+/* This function writes a frame buffer out.
+ * param f: the frame writer
+ * param buf: the frame buffer, 0 or 1
+ * param round: the round the frame is of, for a file per frame
+ */
+void frames_write(struct frames *f, int buf, int round){
+    char name[4096];
+    int fd = f->fd;
+
+    if (f->path){
+        snprintf(name, sizeof(name), f->path, round);
+        fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0){
+            perror(name);
+            exit(1);
+        }
+    }
+    if (write_all(fd, f->bufs[buf], f->size) != 0){
+        perror("write: frame");
+        exit(1);
+    }
+    if (f->path){
+        close(fd);
+    }
+    f->written++;
+}
+
+/* This function closes the output and frees the frame writer.
+ * param f: the frame writer
+ * returns the number of frames written
+ */
+int frames_close(struct frames *f){
+    int written = f->written;
+
+    if (f->fd >= 0){
+        close(f->fd);
+    }
+    free(f->bufs[0]);
+    free(f->bufs[1]);
+    free(f);
+    return written;
+}
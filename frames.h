@@ -0,0 +1,58 @@
+#ifndef __FRAMES_H__
+#define __FRAMES_H__
+
+#include <stdint.h>
+#include "grid.h"
+
+/* This file declares the frame writer for output mode 3, which saves
+ * images of the board instead of showing them, for machines with no
+ * display. Each frame is the board one pixel per cell, live cells black:
+ *   - FRAMES_PPM: binary PPM (P6), dead cells in the color of the thread
+ *     that plays them, as ParaVisi shows them
+ *   - FRAMES_PGM: binary PGM (P5), dead cells white
+ *   - FRAMES_RAW: the PPM's pixels with no header, rgb24, for a video
+ *     encoder:
+ *       ./gol f.txt 3 4 0 0 -E raw 1 - | ffmpeg -f rawvideo \
+ *           -pix_fmt rgb24 -s COLSxROWS -i - out.mp4
+ * A path with a %d in it (like frame%05d.ppm) gets a file per frame,
+ * named for its round; any other path gets every frame, one after
+ * another, which for PPM and PGM is a stream ffmpeg reads with
+ * -f image2pipe. The path - is standard output, and then everything the
+ * program prints goes to standard error instead (see
+ * frames_claim_stdout).
+ *
+ * A frame is encoded straight from the bit-packed board, a part at a
+ * time, so the threads can each encode their own part into the same
+ * buffer. There are two buffers, so one frame can be written while the
+ * next is encoded; a frame goes out in one write. */
+
+#define FRAMES_PPM  (0)
+#define FRAMES_PGM  (1)
+#define FRAMES_RAW  (2)
+
+struct frames;
+
+/* returns the FRAMES_ format called name (ppm, pgm or raw), or -1 */
+int frames_format(const char *name);
+
+/* Takes standard output for the frames, before anything else is printed
+ * to it; frames_open does this for the path - if it hasn't been done. */
+void frames_claim_stdout(void);
+
+/* Sets up to write frames of boards laid out as g to path; exits if
+ * path can't be opened, or has a % in it that isn't one %d. */
+struct frames *frames_open(const struct grid *g, int format,
+        const char *path);
+
+/* Encodes rows r0..r1, columns c0..c1 of a board into frame buffer buf
+ * (0 or 1), with dead cells in the color dead (red, green, blue). */
+void frames_encode(struct frames *f, int buf, uint64_t *cells, int r0,
+        int r1, int c0, int c1, const uint8_t *dead);
+
+/* Writes frame buffer buf out as the frame of round. */
+void frames_write(struct frames *f, int buf, int round);
+
+/* returns the number of frames written; closes the output and frees f */
+int frames_close(struct frames *f);
+
+#endif  /* __FRAMES_H__ */
@@ -7,17 +7,23 @@
 /*This file implements a program to play Conway's Game of Life. The program
 reads in an input file that specifies the grid size and number of iterations
 of the game to play, then lists a number of coordinates that start off
-as alive. The game can be played in three output modes: no output, an
-ascii animation output, and a ParaVisi animation output mode. In the rounds
+as alive. The game can be played in four output modes: no output, an
+ascii animation output, a ParaVisi animation output mode, and a frame
+export mode that writes images of the board (PPM, PGM or raw frames for
+a video encoder, see frames.h) for machines with no display. In the rounds
 of the game, a live cell dies if there are 0 or 1 live neighbors. If there
 are 2 or 3 live neighbors, the cell lives, and if the live cell has 4 neighbors
 it will die. A dead cell with 3 live neighbors will come alive and will
 stay dead with any other number of live neighbors. Each cell has eight
 neighbors. This includes the corners and edges, they wrap around to the
-opposite side of the board. At the end of the ascii and no output runs,
+opposite side of the board. At the end of every run but ParaVisi's,
 the total runtime of the program is printed, along with the number of live
 cells at the end of the final round.
 
+The board is stored bit-packed, 64 cells to a 64-bit word (see grid.h),
+and each round updates a whole word of cells at a time with bit-sliced
+adders.
+
 Additionally, the user can specify the number of threads they want the program
 to run on. The user can also choose whether the threads are partitioned
 in the board by row or column.
@@ -38,28 +44,143 @@ paravisi quit issue
  * ./gol file1.txt  0  # run with config file file1.txt, do not print board
  * ./gol file1.txt  1  # run with config file file1.txt, ascii animation
  * ./gol file1.txt  2  # run with config file file1.txt, ParaVis animation
+ * ./gol file1.txt  3  # run with config file file1.txt, writing frames
+ *                    # as -E says, with no display needed
  *
+ * Options may follow the five required arguments:
+ *   -k kernel   force the next-round kernel: scalar, avx2, avx512 or auto
+ *               (default auto: the fastest one CPUID says this CPU has)
+ *   -R rule     play a Life-like rule other than Conway's B3/S23, in B/S
+ *               notation (B36/S23) or by name (highlife, daynight, seeds,
+ *               replicator, maze, 2x2, morley, lwod); those rules, and
+ *               Conway's, have kernels built just for them (see kernel.c)
+ *   -e engine   life (default) plays round by round on the threads;
+ *               hashlife jumps ahead with HashLife on one thread, for
+ *               long runs; sparse plays only the parts of the board near
+ *               live cells, on one thread, for nearly empty boards; auto
+ *               plays with life or sparse depending on how many cells
+ *               are alive, switching as that changes (all but life need
+ *               output mode 0)
+ *   -p          pin each thread to a CPU, and have each thread touch its
+ *               own part of the boards first so the pages are allocated
+ *               on its NUMA node
+ *   -C n file   write a snapshot of the board to file every n rounds
+ *               (n = 0: once, before the first round), see snapshot.h
+ *   -c period   stop early once the board repeats itself, with a period
+ *               of up to period rounds (a still life has period 1); the
+ *               rounds that are left are skipped, so the result is the
+ *               same as playing them all
+ *   -S format file
+ *               write the population, births and deaths after every round
+ *               to file (- for stdout), as csv or bin records (see gol.h)
+ *   -s spins    times a thread checks the round barrier before going to
+ *               sleep (0 sleeps right away; by default it spins only if
+ *               there is a CPU for every thread, see pool.h)
+ *   -b rows cols rounds
+ *               the board and rounds for input files in RLE format (the
+ *               pattern is placed in the middle of the board)
+ *   -B          batch mode: the input files are lists of boards, each
+ *               played whole by one thread, with the threads taking the
+ *               next board as they finish (see run_batch)
+ *   -F fps      draw at most fps frames a second in output modes 1 and 2
+ *               (default 10, 0 for as many as the terminal or window
+ *               takes); the rounds are never slowed down, those played
+ *               between frames just aren't drawn
+ *   -A glyphs   how output mode 1 draws the board: cells (" @" and " ."
+ *               per cell), half (a half block per 1x2 cells), braille (a
+ *               braille glyph per 2x4 cells), fit (the first of those
+ *               that fits the terminal, shrunk if none do) or plain (each
+ *               frame printed whole, as a log); only the cells that change
+ *               are redrawn, see term.h (default fit, or plain if stderr
+ *               isn't a terminal)
+ *   -E format n path
+ *               in output mode 3, write the board every n rounds (and
+ *               before the first) as ppm or pgm images, or raw rgb24
+ *               frames; a path with a %d in it gets a file per frame,
+ *               named for the round, any other gets all of them, and -
+ *               is stdout (see frames.h)
+ *   -V          play the game a second time with a plain reference that
+ *               keeps a byte per cell and wraps with modulo, and check
+ *               that both end with the same board (see verify_game); slow,
+ *               for testing the engines on odd board shapes (make check
+ *               runs it on the boards in tests/)
+ * Any other arguments after the first five are more input files, played
+ * one after another with the same settings and the same threads:
+ * ./gol file1.txt 0 4 0 0 file2.txt file3.txt
+ * An input file may also be a snapshot, which resumes the saved game
+ * where it left off, or a pattern in RLE format (see loader.h), which
+ * needs -b.
  */
+#ifdef GOL_NO_VISI
+#include "novisi.h"
+#else
 #include <pthreadGridVisi.h>
+#endif
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
 #include <pthread.h>
 #include "colors.h"
+#include "grid.h"
+#include "kernel.h"
+#include "hashlife.h"
+#include "sparse.h"
+#include "pool.h"
+#include "snapshot.h"
+#include "loader.h"
+#include "gol.h"
+#include "trace.h"
+#include "render.h"
+#include "term.h"
+#include "frames.h"
 
 /****************** Definitions **********************/
 /* Three possible modes in which the GOL simulation can run */
 #define OUTPUT_NONE   (0)   // with no animation
 #define OUTPUT_ASCII  (1)   // with ascii animation
 #define OUTPUT_VISI   (2)   // with ParaVis animation
-
-/* Used to slow down animation run modes: usleep(SLEEP_USECS);
- * Change this value to make the animation run faster or slower
+#define OUTPUT_FRAMES (3)   // writing images of the board to files (-E)
+
+/* Output mode 1 prints every frame whole with print_board, one after the
+ * other, instead of drawing it with term.h */
+#define ASCII_PLAIN   (-1)
+
+/* The two ways of playing the game */
+#define ENGINE_LIFE      (0)   // round by round, on all the threads
+#define ENGINE_HASHLIFE  (1)   // HashLife jumps (see hashlife.c)
+#define ENGINE_SPARSE    (2)   // only the live chunks (see sparse.c)
+#define ENGINE_AUTO      (3)   // life or sparse, whichever fits the board
+
+/* -e auto plays with the sparse engine while fewer than SPARSE_DENSITY
+ * of the cells are alive, and hands the board back to the threads once
+ * more than SPARSE_DENSITY_OUT are; the threads play AUTO_ROUNDS rounds
+ * between looks at the density */
+#define SPARSE_DENSITY      (0.001)
+#define SPARSE_DENSITY_OUT  (0.004)
+#define AUTO_ROUNDS         (64)
+
+/* Most frames a second the animation run modes draw, unless -F says
+ * otherwise; the game itself plays on at full speed (see render.h)
  */
-#define SLEEP_USECS    (100000)
+#define FRAME_RATE     (10)
+
+
+/* The board is split into tiles of TILE_ROWS rows by TILE_WORDS words
+ * (64x256 cells) to keep track of which parts of it are still changing */
+#define TILE_ROWS      (64)
+#define TILE_WORDS     (4)
+
+/* Longest cycle -c can look for */
+#define MAX_PERIOD     (4096)
+
+/* At most this many tiles along one side of the board are within reach
+ * of a tile's cells over one barrier (see tile_span) */
+#define TILE_SPAN      (8)
 
 /* A global variable to keep track of the number of live cells in the
  * world (this is the ONLY global variable you may use in your program)
@@ -83,9 +204,10 @@ struct gol_data {
     int output_mode; // set to:  OUTPUT_NONE, OUTPUT_ASCII, or OUTPUT_VISI
 
     // TODO: add more fields for gol_data that your play_gol function needs
-    int* world;
-    int* world_copy;
-    int divide_mode; // 1 is col, 0 is row
+    uint64_t *world;      // bit-packed board: one bit per cell, row-major
+    uint64_t *world_copy; // the next round is written here, then swapped
+    struct grid grid;     // layout of both boards (see grid.h)
+    int divide_mode; // 0 is col strips, 1 is row strips, 2 is 2D blocks
     int threads;
     int print;
 
@@ -96,6 +218,49 @@ struct gol_data {
     int col_end;
     int mini_rows;  // the row dimension
     int mini_cols;
+    int word_start; // first word of each row this thread updates
+    int word_end;   // last word of each row this thread updates
+    int grid_p;     // rows of blocks in the partition grid
+    int grid_q;     // columns of blocks in the partition grid
+    int block_r;    // this thread's block row in the grid
+    int block_c;    // this thread's block column in the grid
+    const struct kernel *kernel; // next-round kernel (scalar, avx2, ...)
+    struct rule rule; // the rule the game is played by (-R)
+    int engine;     // one of the ENGINE_ ways of playing
+    int round;      // number of barriers this thread has passed
+    int steps;      // rounds played per tile between barriers (-t)
+    int spin;       // barrier spin budget (-s)
+    int pin;        // pin threads and place the boards near them (-p)
+    int generation; // rounds played before this run, when resuming
+    int checkpoint_every;        // rounds between snapshots (-C), or -1
+    const char *checkpoint_path; // where -C writes snapshots
+    int board_rows; // board and rounds for RLE inputs (-b), 0 if not set
+    int board_cols;
+    int board_iters;
+    int live;       // live cells on the board as it was loaded
+    int quiet;      // don't print the results (benchmarks, batches)
+    int batch;      // the input files are lists of boards to play (-B)
+    int max_period; // longest cycle -c looks for, 0 if it doesn't
+    int verify;     // check the final board against verify_game's (-V)
+    double fps;     // most frames a second the animations draw (-F)
+    int frame_format; // FRAMES_ format output mode 3 writes (-E)
+    int frame_every;  // rounds between frames, 0 if -E wasn't given
+    const char *frame_path;
+    int glyphs;     // how output mode 1 draws the board: a TERM_ glyph
+                    // (see term.h), or ASCII_PLAIN (-A)
+    FILE *stats;    // per-round statistics stream (-S), or NULL
+    int stats_binary; // write the stream as struct gol_stats records
+    const char *stats_path;
+    double secs;    // how long run_game took to play the rounds
+    char **inputs;  // input files to play, inputs[0] is argv[1]
+    int num_inputs;
+    uint64_t *block_buf; // this thread's tile buffers when steps > 1
+    int tiles_r;    // number of rows of tiles
+    int tiles_c;    // number of columns of tiles
+    int *tile_stamp; // last round in which each tile changed (shared)
+    int tiles_done;    // tiles this thread has updated, over all rounds
+    int tiles_skipped; // tiles this thread found nothing to do in
+    int tiles_stolen;  // tiles this thread took from other threads
 
 
     /* fields used by ParaVis library (when run in OUTPUT_VISI mode). */
@@ -107,19 +272,49 @@ struct gol_data {
 /****************** Function Prototypes **********************/
 /* the main gol game playing loop (prototype must match this) */
 void *play_gol(void *args);
+void play_hashlife(struct gol_data *data);
+static int play_sparse(struct gol_data *data, uint64_t *world, int rounds,
+        double density);
+static void play_auto(struct gol_data *data, struct gol_data *targs,
+        struct pool *pool);
 void *print_stats(void *args);
 /* init gol data from the input file and run mode cmdline args */
 int init_game_data_from_args(struct gol_data *data, char **argv);
 /* print board to the terminal (for OUTPUT_ASCII mode) */
-void print_board(struct gol_data *data, int round);
-
-int openfile(struct gol_data *data, FILE *infile);
-void make_world(struct gol_data *data, char **argv, FILE *infile);
-void update_cells(struct gol_data *data);
-int check_neighbors(struct gol_data *data, int row, int col);
+void print_board(struct gol_data *data, uint64_t *world, int round,
+        int live);
+
+void load_game(struct gol_data *data, const char *path);
+void make_world(struct gol_data *data);
+void make_tiles(struct gol_data *data);
+void load_snapshot(struct gol_data *data, const char *path);
+void random_world(struct gol_data *data, double density,
+        unsigned long seed);
+void write_checkpoint(struct gol_data *data, int before, int after);
+void open_stats(struct gol_data *data);
+uint64_t board_hash(struct gol_data *data);
+static void find_cycle(struct gol_data *data, int round);
+void write_stats(struct gol_data *data, int round, int births, int delta);
+void check_threads(struct gol_data *data);
+void run_game(struct gol_data *data, struct pool *pool);
+static void verify_game(struct gol_data *data, uint64_t *start,
+        uint64_t *end);
+void run_batch(struct gol_data *data, const char *list, struct pool *pool);
+void place_world(struct gol_data *data, struct gol_data *targs,
+        struct pool *pool);
+void update_cells(struct gol_data *data, int steps);
+static void reduce_live(struct gol_data *data, int round);
+static void encode_frame(struct gol_data *data, int round);
+static int update_rows(struct gol_data *data, int r0, int r1, int k0,
+        int k1, uint64_t *changed, int *births, uint64_t *hash);
 void update_colors(struct gol_data *data);
+static void draw_ascii(void *arg, const struct frame *frame);
+static void draw_visi(void *arg, const struct frame *frame);
 void validation(int argc, char **argv, struct gol_data* data);
+void parse_options(int argc, char **argv, struct gol_data* data);
 void partition(struct gol_data *data, pthread_t *tid, struct gol_data* targs);
+void assign_tiles(struct gol_data *data, struct gol_data *targs);
+void print_tile_stats(struct gol_data *targs, int threads);
 /**************************************************************/
 
 
@@ -130,110 +325,507 @@ int setup_animation(struct gol_data* data);
 static char visi_name[] = "GOL!";
 /**************************************************************/
 
+/* Each thread's change in live cells for one round, padded out to a
+ * cache line of its own so threads never write to the same line. There
+ * are two sets of slots used on alternating rounds: after the barrier,
+ * thread 0 adds up one round's slots into total_live while the other
+ * threads are already filling in the next round's. */
+struct live_slot {
+    int delta;
+    int births;     // cells that came alive, only counted for -S
+    uint64_t hash;  // change in the board hash, only counted for -c
+} __attribute__((aligned(64)));
+
+/* A round in the history -c checks each round against */
+struct cycle_entry {
+    uint64_t hash;  // board_hash of the round
+    int live;       // total_live after the round
+};
+
+/* A thread's tiles for one round. The thread takes tiles off the tail
+ * of its queue, and threads that run out of their own work steal from
+ * the head. Head (low half) and tail (high half) share one 64-bit word,
+ * so taking from either end is a single compare-and-swap. */
+struct tile_queue {
+    uint64_t ends;  // head and tail index into tiles
+    int *tiles;     // the tiles the thread starts each round with
+    int count;      // number of tiles
+} __attribute__((aligned(64)));
+
 static int total_live = 0;
-static pthread_barrier_t done;
-static pthread_mutex_t my_mutex;
+static uint64_t total_hash;     // board_hash of world, kept up to date
+static int stop_round;          // rounds to play; -c can cut this short
+static struct cycle_entry *history;
+static int cycle_round;         // round found to repeat an earlier one
+static int cycle_period;        // how many rounds earlier, 0 if none
+static struct pool_barrier done;
+static struct pool *workers;        // started before the first file is read
+static struct live_slot *live_slots;
+static struct tile_queue *queues;
+static struct renderer *renderer;   // draws output modes 1 and 2, or NULL
+static struct term *term;           // draws output mode 1, or NULL
+static struct frames *frames;       // writes output mode 3, or NULL
 
 /************************ Main Function ***********************/
+#ifndef GOL_NO_MAIN
 int main(int argc, char **argv) {
 
-    int ret, i;
+    int i;
+    struct gol_data data, next;
+
+    /* check command line arguments, and read the first file on the
+     * worker threads, which are started once and play every input file */
+    validation(argc, argv, &data);
+
+    pool_barrier_init(&done, data.threads, data.spin);
+
+    live_slots = aligned_alloc(64, sizeof(struct live_slot)*2*data.threads);
+    if (!live_slots) { perror("aligned_alloc: live slots"); exit(1); }
+    TRACE_INIT(data.threads);
+    open_stats(&data);
+
+    if (data.batch) {
+        for (i = 0; i < data.num_inputs; i++) {
+            run_batch(&data, data.inputs[i], workers);
+        }
+    } else {
+        run_game(&data, workers);
+    }
+
+    for (i = 1; i < data.num_inputs && !data.batch; i++) {
+        //same settings, next board
+        next = data;
+        load_game(&next, data.inputs[i]);
+        check_threads(&next);
+        run_game(&next, workers);
+    }
+
+    TRACE_FINISH();
+    if (data.stats && data.stats != stdout) {
+        fclose(data.stats);
+    }
+
+    // clean-up memory before exit
+    pool_destroy(workers);
+    free(live_slots);
+    free(data.inputs);
+
+    return 0;
+
+}
+#endif  /* GOL_NO_MAIN */
+
+/* This function plays one benchmark game (see gol.h): it sets up the
+ * settings main would get from the command line, makes a random board,
+ * and plays it on a pool of its own.
+ * param bench: the game to play, and where its results go
+ */
+void gol_bench_run(struct gol_bench *bench) {
+
     struct gol_data data;
-    double secs;
-    struct timeval start_time, stop_time;
+    struct pool *pool;
+
+    memset(&data, 0, sizeof(data));
+    data.rows = bench->rows;
+    data.cols = bench->cols;
+    data.iters = bench->iters;
+    data.output_mode = OUTPUT_NONE;
+    data.threads = bench->threads;
+    data.divide_mode = bench->divide_mode;
+    data.engine = ENGINE_LIFE;
+    data.steps = bench->steps;
+    data.spin = -1;
+    data.checkpoint_every = -1;
+    data.quiet = 1;
+
+    if (data.rows < 1 || data.cols < 1 || data.iters < 0 ||
+            data.threads < 1 || data.divide_mode < 0 ||
+            data.divide_mode > 2 || data.steps < 1 ||
+            data.steps > TILE_ROWS) {
+        printf("Bad benchmark settings: %dx%d, %d rounds, %d threads,"\
+                " partition mode %d, %d steps\n", data.rows, data.cols,
+                data.iters, data.threads, data.divide_mode, data.steps);
+        exit(1);
+    }
+    check_threads(&data);
+    data.rule = RULE_CONWAY;
+    if (bench->rule && rule_parse(bench->rule, &data.rule) != 0) {
+        printf("Unknown rule: %s\n", bench->rule);
+        exit(1);
+    }
+    data.kernel = kernel_select(bench->kernel, data.rule);
+    if (data.kernel == NULL) {
+        printf("Kernel %s is unknown or not supported on this CPU.\n",
+                bench->kernel);
+        exit(1);
+    }
 
-    pthread_t *tid;
-    struct gol_data *targs;  // Arg passed into each thread
+    pool = pool_create(data.threads, 0);
+    pool_barrier_init(&done, data.threads, data.spin);
+    live_slots = aligned_alloc(64, sizeof(struct live_slot)*2*data.threads);
+    if (!live_slots) { perror("aligned_alloc: live slots"); exit(1); }
+
+    random_world(&data, bench->density, bench->seed);
+    TRACE_INIT(data.threads);
+    run_game(&data, pool);
+    TRACE_FINISH();
+
+    bench->secs = data.secs;
+    bench->live = total_live;
+    bench->kernel_name = data.kernel->name;
+
+    pool_destroy(pool);
+    free(live_slots);
+    live_slots = NULL;
+}
+
+/* One board of a batch (see run_batch) */
+struct batch_board {
+    char *path;         // input file, or NULL for a random board
+    int rows;           // size, rounds, density and seed of a random board
+    int cols;
+    int iters;
+    double density;
+    unsigned long seed;
+    int line;           // line of the list the board is on
+
+    // results
+    int live;           // live cells after the last round
+    int played;         // rounds played before the board stood still
+    double secs;        // time to load and play the board
+};
+
+/* A batch being played by the pool */
+struct batch {
+    struct gol_data *settings;  // the run settings every board is played with
+    struct batch_board *boards;
+    int count;
+    int next;           // next board for a worker to take
+};
 
+/* What each worker is handed by pool_start */
+struct batch_worker {
+    struct batch *batch;
+};
 
-    if (pthread_mutex_init(&my_mutex, NULL)) { 
-        printf("pthread_mutex_init error\n");
+/* This function reads a batch list. Each line is either the name of an
+ * input file, or "random rows cols rounds density seed" for a random
+ * board (see random_world). Blank lines and lines starting with # are
+ * skipped.
+ * param list: name of the list file
+ * param count: set to the number of boards
+ * returns the boards */
+static struct batch_board *read_batch(const char *list, int *count){
+    struct batch_board *boards = NULL, *b;
+    char line[4096], name[4096];
+    int n = 0, size = 0, number = 0;
+    FILE *infile = fopen(list, "r");
+
+    if (infile == NULL) {
+        printf("Error: failed to open file: %s\n", list);
         exit(1);
     }
+    while (fgets(line, sizeof(line), infile)) {
+        number++;
+        if (sscanf(line, "%4095s", name) != 1 || name[0] == '#') {
+            continue;
+        }
+        if (n == size) {
+            size = size ? 2*size : 64;
+            boards = realloc(boards, sizeof(struct batch_board)*size);
+            if (!boards) { perror("realloc: batch"); exit(1); }
+        }
+        b = &boards[n++];
+        memset(b, 0, sizeof(*b));
+        b->line = number;
+        if (strcmp(name, "random") == 0) {
+            if (sscanf(line, "%*s %d %d %d %lf %lu", &b->rows, &b->cols,
+                        &b->iters, &b->density, &b->seed) != 5 ||
+                    b->rows < 1 || b->cols < 1 || b->iters < 0 ||
+                    b->density < 0 || b->density > 1) {
+                printf("Error: bad random board on line %d of %s\n",
+                        number, list);
+                exit(1);
+            }
+        } else {
+            b->path = strdup(name);
+            if (!b->path) { perror("strdup: batch"); exit(1); }
+        }
+    }
+    fclose(infile);
+    *count = n;
+    return boards;
+}
 
-    /* check command line arguments */
-    validation(argc, argv, &data);
+/* This function loads and plays one board of a batch, start to finish,
+ * on the calling thread alone. There is no partition and no barrier:
+ * the thread just updates the whole board round after round. A round in
+ * which nothing changes ends the game early, since every round after it
+ * would be the same.
+ * param settings: the run settings
+ * param b: the board, where the results go too */
+static void play_board(struct gol_data *settings, struct batch_board *b){
+    struct gol_data data = *settings;
+    struct timeval start_time, stop_time;
+    uint64_t changed, *temp;
+    int i;
+
+    gettimeofday(&start_time, NULL);
+    data.threads = 1;
+    data.quiet = 1;
+    if (b->path) {
+        load_game(&data, b->path);
+    } else {
+        data.rows = b->rows;
+        data.cols = b->cols;
+        data.iters = b->iters;
+        random_world(&data, b->density, b->seed);
+    }
+    b->rows = data.rows;
+    b->cols = data.cols;
+    b->iters = data.iters;
+
+    for (i = 0; i < data.iters; i++) {
+        changed = 0;
+        data.live += update_rows(&data, 0, data.rows-1, 0, data.grid.words-1,
+                &changed, NULL, NULL);
+        temp = data.world;
+        data.world = data.world_copy;
+        data.world_copy = temp;
+        if (!changed) {
+            i++;
+            break;
+        }
+    }
+    b->live = data.live;
+    b->played = i;
+
+    grid_free(&data.grid, data.world);
+    grid_free(&data.grid, data.world_copy);
+    free(data.tile_stamp);
+    gettimeofday(&stop_time, NULL);
+    b->secs = (stop_time.tv_sec - start_time.tv_sec) +
+        (stop_time.tv_usec - start_time.tv_usec)/1000000.0;
+}
 
-    // Allocate tid
-    tid = malloc(sizeof(pthread_t) * data.threads);
-    if (!tid) { perror("malloc: pthread_t array"); exit(1); }
+/* This function is run by every worker for a batch: it takes boards off
+ * the list one at a time until there are none left.
+ * param args: pointer to the worker's struct batch_worker */
+static void *play_batch(void *args){
+    struct batch *batch = ((struct batch_worker *)args)->batch;
+    int n;
 
-    targs = malloc(sizeof(struct gol_data) * data.threads);
-    if (!targs) { perror("malloc: targs array"); exit(1); }
+    while ((n = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) <
+            batch->count) {
+        play_board(batch->settings, &batch->boards[n]);
+    }
+    return NULL;
+}
+
+/* This function plays every board on a batch list, each on one of the
+ * pool's threads, and prints a line for each board (in the order of the
+ * list) and how many boards a second the batch got through. Small boards
+ * are played faster one to a thread than split over all of them, since
+ * a round of a small board is over long before the threads could meet
+ * at a barrier.
+ * param data: pointer to a struct gol_data with the run settings
+ * param list: name of the list file
+ * param pool: the worker pool
+ */
+void run_batch(struct gol_data *data, const char *list, struct pool *pool){
+    struct batch batch;
+    struct batch_worker *workers;
+    struct timeval start_time, stop_time;
+    double secs, cells = 0;
+
+    batch.settings = data;
+    batch.boards = read_batch(list, &batch.count);
+    batch.next = 0;
+    workers = malloc(sizeof(struct batch_worker)*data->threads);
+    if (!workers) { perror("malloc: batch workers"); exit(1); }
+    for (int i = 0; i < data->threads; i++) {
+        workers[i].batch = &batch;
+    }
 
-    ret = pthread_barrier_init(&done, NULL, data.threads);
-    if (ret != 0) {perror("pthread_barrier_init"); exit(1); }
+    gettimeofday(&start_time, NULL);
+    pool_start(pool, play_batch, workers, sizeof(struct batch_worker));
+    pool_wait(pool);
+    gettimeofday(&stop_time, NULL);
+    secs = (stop_time.tv_sec - start_time.tv_sec) +
+        (stop_time.tv_usec - start_time.tv_usec)/1000000.0;
 
-    /* initialize ParaVisi animation (if applicable) */
-    if (data.output_mode == OUTPUT_VISI) {
-        setup_animation(&data);
-        
+    for (int i = 0; i < batch.count; i++) {
+        struct batch_board *b = &batch.boards[i];
+        char name[64];
+
+        if (!b->path) {
+            snprintf(name, sizeof(name), "random:%lu", b->seed);
+        }
+        printf("%s: %dx%d, %d rounds, %d live cells, %.6f seconds",
+                b->path ? b->path : name, b->rows, b->cols, b->iters,
+                b->live, b->secs);
+        if (b->played < b->iters) {
+            printf(" (still after round %d)", b->played);
+        }
+        printf("\n");
+        cells += (double)b->rows*b->cols*b->played;
+        free(b->path);
+    }
+    printf("Batch %s: %d boards in %.3f seconds on %d threads"\
+            " (%.1f boards/s, %.3g cells/s)\n", list, batch.count, secs,
+            data->threads, (secs > 0) ? batch.count/secs : 0.0,
+            (secs > 0) ? cells/secs : 0.0);
+
+    free(batch.boards);
+    free(workers);
+}
+
+/* This function plays one game on the pool's threads, prints how long it
+ * took and how many cells are alive at the end, and frees the boards.
+ * param data: pointer to a struct gol_data with the board loaded and
+ *         the run settings filled in
+ * param pool: the worker pool, one worker per thread
+ */
+void run_game(struct gol_data *data, struct pool *pool) {
+
+    int i;
+    double secs = 0.0;
+    struct timeval start_time, stop_time;
+    char name[24];  // the rule in B/S notation
+    uint64_t *start = NULL;  // the board before the first round, for -V
+
+    struct gol_data *targs;  // Arg passed into each thread
+
+    targs = malloc(sizeof(struct gol_data) * data->threads);
+    if (!targs) { perror("malloc: targs array"); exit(1); }
+
+    /* initialize ParaVisi animation (if applicable); only the renderer
+     * draws, so the animation is set up for one thread */
+    if (data->output_mode == OUTPUT_VISI) {
+        struct gol_data one = *data;
+        one.threads = 1;
+        setup_animation(&one);
+        data->handle = one.handle;
+        data->image_buff = one.image_buff;
     }
     
-    partition(&data, tid, targs);
+    partition(data, NULL, targs);
+    assign_tiles(data, targs);
+
+    total_live = data->live;
+    stop_round = data->iters;
+    cycle_period = 0;
+    if (data->max_period > 0) {
+        history = malloc(sizeof(struct cycle_entry)*data->max_period);
+        if (!history) { perror("malloc: cycle history"); exit(1); }
+        total_hash = board_hash(data);
+    }
+    if (data->pin && (data->engine == ENGINE_LIFE ||
+                data->engine == ENGINE_AUTO)) {
+        place_world(data, targs, pool);
+    }
+    if (data->verify) {
+        start = grid_alloc(&data->grid);
+        memcpy(start, data->world, grid_bytes(&data->grid));
+    }
+
+    if (data->print) {
+        rule_format(data->rule, name);
+        printf("kernel: %s\n", data->kernel->name);
+        printf("rule: %s%s\n", name, data->kernel->rule ? "" :
+                " (looked up as it goes, it has no kernel of its own)");
+        if (data->steps > 1) {
+            printf("rounds per barrier: %d\n", data->steps);
+        }
+    }
+
+    /* frames: the threads encode them as they go (see play_gol) */
+    frames = NULL;
+    if (data->output_mode == OUTPUT_FRAMES) {
+        frames = frames_open(&data->grid, data->frame_format,
+                data->frame_path);
+    }
 
-    /* ASCII output: clear screen & print the initial board */
-    if (data.output_mode == OUTPUT_ASCII) {
-        if (system("clear")) { perror("clear"); exit(1); }
-        print_board(&data, 0);
+    /* animations: start the renderer, and show it the initial board */
+    renderer = NULL;
+    term = NULL;
+    if (data->output_mode == OUTPUT_ASCII && data->glyphs != ASCII_PLAIN) {
+        term = term_open(&data->grid, data->glyphs, STDERR_FILENO);
+    }
+    if (data->output_mode == OUTPUT_ASCII ||
+            data->output_mode == OUTPUT_VISI) {
+        renderer = render_start(&data->grid, data->fps,
+                (data->output_mode == OUTPUT_ASCII) ? draw_ascii : draw_visi,
+                targs);
+        render_publish(renderer, data->world, 0, total_live);
     }
     
     /* Invoke play_gol in different ways based on the run mode */
 
 
-    if (data.output_mode == OUTPUT_NONE) {  // run with no animation
-        ret = gettimeofday(&start_time, NULL);
-        for (i = 0; i < data.threads; i++) {
-            ret = pthread_create(&tid[i], 0, play_gol, &targs[i]);
-        }
-        if (ret) { perror("Error pthread_create\n"); exit(1); }
+    if (data->output_mode == OUTPUT_NONE &&
+            data->engine == ENGINE_HASHLIFE) {  // jump ahead with HashLife
+        gettimeofday(&start_time, NULL);
+        play_hashlife(data);
     }
 
-    else if (data.output_mode == OUTPUT_ASCII) { // run with ascii animation
-        ret = gettimeofday(&start_time, NULL);
-        
-        for (i = 0; i < data.threads; i++) {
-            ret = pthread_create(&tid[i], 0, play_gol, &targs[i]);
-        }
-        if (ret) { perror("Error pthread_create\n"); exit(1); }
+    else if (data->output_mode == OUTPUT_NONE &&
+            data->engine == ENGINE_SPARSE) {  // only the live chunks
+        gettimeofday(&start_time, NULL);
+        play_sparse(data, data->world, data->iters, 1);
+    }
+
+    else if (data->output_mode == OUTPUT_NONE &&
+            data->engine == ENGINE_AUTO) {  // life or sparse as it goes
+        gettimeofday(&start_time, NULL);
+        play_auto(data, targs, pool);
+    }
 
-        // clear the previous print_board output from the terminal:
-        if (system("clear")) { perror("clear"); exit(1); }
+    else if (data->output_mode == OUTPUT_NONE ||
+            data->output_mode == OUTPUT_FRAMES) {  // run with no animation
+        gettimeofday(&start_time, NULL);
+        pool_start(pool, play_gol, targs, sizeof(struct gol_data));
+    }
 
+    else if (data->output_mode == OUTPUT_ASCII) { // run with ascii animation
+        gettimeofday(&start_time, NULL);
+        
+        pool_start(pool, play_gol, targs, sizeof(struct gol_data));
     }
-    else if (data.output_mode == OUTPUT_VISI) {  
+    else if (data->output_mode == OUTPUT_VISI) {  
         // OUTPUT_VISI: run with ParaVisi animation
         // tell ParaVisi that it should run play_gol
 
-        for (i = 0; i < data.threads; i++) {
-            ret = pthread_create(&tid[i], 0, play_gol, &targs[i]);
-        }
-        if (ret) { perror("Error pthread_create\n"); exit(1); }
-        run_animation(data.handle, data.iters);
+        pool_start(pool, play_gol, targs, sizeof(struct gol_data));
+        run_animation(data->handle, data->iters);
     }
     else {
         //checks for a valid output mode: 0, 1, 2
-        printf("Invalid output mode: %d\n", data.output_mode);
+        printf("Invalid output mode: %d\n", data->output_mode);
         printf("Check your game data initialization\n");
         exit(1);
     }
 
 
-    // Join thread
-    for (int i = 0; i < data.threads; i++){
-        pthread_join(tid[i], NULL);
+    // Wait for the workers to finish the game
+    if (data->engine == ENGINE_LIFE) {
+        pool_wait(pool);
+    }
+    //a reader on a pipe sees each game as soon as it ends
+    if (data->stats) {
+        fflush(data->stats);
     }
 
 
     // NOTE: you need to determine how and where to add timing code
     //       in your program to measure the total time to play the given
     //       number of rounds played.
-    if (data.output_mode != OUTPUT_VISI) {
+    if (data->output_mode != OUTPUT_VISI) {
         // Computes the total runtime in seconds, including fractional
         // seconds (e.g., 10.5; don't round to 10). for no output and ascii
         //modes
         secs = 0.0;
-        ret = gettimeofday(&stop_time, NULL);
+        gettimeofday(&stop_time, NULL);
         //start time in microseconds
         double micros_st = start_time.tv_usec;
         //convert microseconds to seconds
@@ -252,31 +844,172 @@ int main(int argc, char **argv) {
         double stop = micros_stop + s_stop;
         //total runtime time: stop-start
         secs = stop - st;
-       
-        
+        data->secs = secs;
+    }
+
+    if (frames) {
+        int written = frames_close(frames);
+        frames = NULL;
+        if (data->print) {
+            printf("frames: wrote %d frames\n", written);
+        }
+    }
+
+    //the rounds are timed without the last frames, which the renderer
+    //may still be drawing
+    if (renderer) {
+        int drawn = render_stop(renderer);
+        renderer = NULL;
+        if (term) {
+            term_close(term);
+            term = NULL;
+        }
+        if (data->print) {
+            printf("render: drew %d of the %d boards\n", drawn,
+                    stop_round + 1);
+        }
+    }
+
+    if (data->output_mode != OUTPUT_VISI && !data->quiet) {
         /* Print the total runtime, in seconds. */
         // NOTE: do not modify these calls to fprintf
         fprintf(stdout, "Total time: %0.3f seconds\n", secs);
         fprintf(stdout, "After %d rounds on %dx%d, the number of live cells is: %d\n\n",
-                data.iters, data.rows, data.cols, total_live);
+                data->iters, data->rows, data->cols, total_live);
+        if (data->generation > 0) {
+            printf("(resumed from a snapshot at round %d, now at round %d)\n",
+                    data->generation, data->generation + data->iters);
+        }
+        if (cycle_period > 0) {
+            printf("(round %d repeats round %d, a cycle of period %d:"\
+                    " played %d of the %d rounds)\n",
+                    data->generation + cycle_round,
+                    data->generation + cycle_round - cycle_period,
+                    cycle_period, stop_round, data->iters);
+        }
     }
 
-    // clean-up memory before exit
-    free(tid);
+    if (data->print && (data->engine == ENGINE_LIFE ||
+                data->engine == ENGINE_AUTO)) {
+        print_tile_stats(targs, data->threads);
+    }
+
+    //the threads swapped their own board pointers as they went, so the
+    //final board is whichever thread 0 ended up with
+    if (data->verify) {
+        verify_game(data, start, (data->engine == ENGINE_LIFE ||
+                    data->engine == ENGINE_AUTO) ? targs[0].world :
+                data->world);
+        grid_free(&data->grid, start);
+    }
+
+    // clean-up memory before the next game
     free(targs);
-    pthread_barrier_destroy(&done);
-    if (pthread_mutex_destroy(&my_mutex)) {
-        printf("pthread_mutex_destroy error\n");
-        exit(1);
+    free(history);
+    history = NULL;
+    for (i = 0; i < data->threads; i++) {
+        free(queues[i].tiles);
     }
+    free(queues);
+    queues = NULL;
+
+    grid_free(&data->grid, data->world);
+    grid_free(&data->grid, data->world_copy);
+    free(data->tile_stamp);
+    data->world = NULL;
+    data->world_copy = NULL;
+    data->tile_stamp = NULL;
+}
 
-    free(data.world);
-    free(data.world_copy);
-    data.world = NULL;
-    data.world_copy = NULL;
+/* This function plays one round of the plain reference that -V checks
+ * against: a byte per cell, row-major, and every neighbor found by
+ * wrapping its row and column around with modulo, so it shares nothing
+ * with the packed board but the rule.
+ * param data: pointer to a struct gol_data, for the size and the rule
+ * param from: the board before the round, rows*cols bytes
+ * param to: where the board after the round goes
+ */
+static void reference_round(struct gol_data *data, const uint8_t *from,
+        uint8_t *to){
+    int rows = data->rows, cols = data->cols, n;
+
+    for (int r = 0; r < rows; r++){
+        for (int c = 0; c < cols; c++){
+            n = 0;
+            for (int dr = -1; dr <= 1; dr++){
+                for (int dc = -1; dc <= 1; dc++){
+                    if (dr != 0 || dc != 0){
+                        n += from[((r + dr + rows) % rows)*cols +
+                            (c + dc + cols) % cols];
+                    }
+                }
+            }
+            if (from[r*cols + c]){
+                to[r*cols + c] = (data->rule.survive >> n) & 1;
+            } else {
+                to[r*cols + c] = (data->rule.birth >> n) & 1;
+            }
+        }
+    }
+}
 
-    return 0;
+/* This function checks a game for -V: it plays the same rounds from the
+ * same start with reference_round, and exits with an error if the board
+ * the game ended with, or its live count, is any different.
+ * param data: pointer to a struct gol_data, after the game
+ * param start: the board before the first round
+ * param end: the board after the last round
+ */
+static void verify_game(struct gol_data *data, uint64_t *start,
+        uint64_t *end){
+    size_t cells = (size_t)data->rows*data->cols;
+    uint8_t *from = calloc(cells, 1), *to = malloc(cells), *temp;
+    const uint64_t *row;
+    long live = 0, wrong = 0, first = -1;
+
+    if (!from || !to) { perror("malloc: reference"); exit(1); }
+    for (int r = 0; r < data->rows; r++){
+        row = grid_row(&data->grid, start, r);
+        for (int c = grid_next_live(&data->grid, row, 0); c < data->cols;
+                c = grid_next_live(&data->grid, row, c+1)){
+            from[(size_t)r*data->cols + c] = 1;
+        }
+    }
+    for (int i = 0; i < data->iters; i++){
+        reference_round(data, from, to);
+        temp = from;
+        from = to;
+        to = temp;
+    }
 
+    for (int r = 0; r < data->rows; r++){
+        row = grid_row(&data->grid, end, r);
+        for (int c = 0; c < data->cols; c++){
+            live += from[(size_t)r*data->cols + c];
+            if (grid_bit(row, c) != from[(size_t)r*data->cols + c]){
+                first = (wrong++ == 0) ? (long)r*data->cols + c : first;
+            }
+        }
+    }
+    free(from);
+    free(to);
+
+    if (wrong > 0 || live != total_live){
+        printf("-V: after %d rounds on %dx%d the board is wrong: %ld cells"\
+                " differ from the reference", data->iters, data->rows,
+                data->cols, wrong);
+        if (first >= 0){
+            printf(", the first at row %ld, column %ld",
+                    first/data->cols, first%data->cols);
+        }
+        printf("; %d live cells counted, %ld in the reference\n",
+                total_live, live);
+        exit(1);
+    }
+    if (!data->quiet){
+        printf("-V: the board matches the reference after %d rounds\n",
+                data->iters);
+    }
 }
 
 /******************** Function Prototypes ************************/
@@ -292,9 +1025,27 @@ int main(int argc, char **argv) {
  * argc: command line count */
 void validation(int argc, char **argv, struct gol_data* data){
     // 
-   if (argc != 6) {
-        printf("Usage: %s infile.txt output_mode[0,1,2] num_threads[n]"\
-              " partition_mode[0,1] print_partition[0,1]\n", argv[0]);
+   if (argc < 6) {
+        printf("Usage: %s infile.txt output_mode[0,1,2,3] num_threads[n]"\
+              " partition_mode[0,1,2] print_partition[0,1] [options]\n"\
+              "Options:\n"\
+              "  -k kernel   scalar, avx2, avx512 or auto\n"\
+              "  -R rule     B3/S23 (default), B36/S23, highlife, seeds...\n"\
+              "  -e engine   life, hashlife, sparse or auto\n"\
+              "  -t steps    rounds per tile between barriers [1-64]\n"\
+              "  -p          pin threads, place memory on their nodes\n"\
+              "  -C n file   snapshot to file every n rounds\n"\
+              "  -S csv|bin file  population, births, deaths per round\n"\
+              "  -c period   stop once the board repeats [1-4096]\n"\
+              "  -F fps      most frames a second to draw (0: no limit)\n"\
+              "  -A glyphs   cells, half, braille, fit or plain\n"\
+              "  -E ppm|pgm|raw n path  frames every n rounds (mode 3)\n"\
+              "  -V          check the result against a plain reference\n"\
+              "  -B          input files are lists of boards to batch\n"\
+              "  -s spins    barrier spins before sleeping\n"\
+              "  -b rows cols rounds  board for RLE input files\n"\
+              "  more input files may follow, played one after another\n",
+              argv[0]);
         exit(1);
     }
 
@@ -303,36 +1054,24 @@ void validation(int argc, char **argv, struct gol_data* data){
 
     int runmode = atoi(argv[2]);
     //spits error if runmode is not one of the valid options
-    if (runmode > 3){
+    if (runmode < 0 || runmode > 3){
         printf("Incorrect run mode entered. options are (0: no visualization,"\
-            " 1: ASCII, 2: ParaVisi)\n");
+            " 1: ASCII, 2: ParaVisi, 3: frames)\n");
         exit(1);
     }
 
-    int ret = init_game_data_from_args(data, argv);
-    if (ret != 0) {
-        printf("Initialization error: file %s\n", argv[1]);
+#ifdef GOL_NO_VISI
+    if (runmode == OUTPUT_VISI){
+        printf("This gol was built without ParaVisi (make NOVISI=1);"\
+            " output mode 3 writes frames to look at instead.\n");
         exit(1);
     }
+#endif
 
-    if(atoi(argv[4]) == 0){
-        //row-wise grid cell allocation
-        if(atoi(argv[3]) > data->rows){
-            printf("Number of threads must be less than number of rows.\n");
-            exit(1);
-        }
-    }
-
-    else if(atoi(argv[4]) == 1){
-        //column-wise grid cell allocation
-        if(atoi(argv[3]) > data->cols){
-            printf("Number of threads must be less than number of colunns.\n");
-            exit(1);
-        }
-    }
+    data->output_mode = runmode;
 
-    else{
-        printf("Please enter 0 or 1 for cell allocation.\n");
+    if ((atoi(argv[4]) < 0) || (atoi(argv[4]) > 2)) {
+        printf("Please enter 0, 1 or 2 for cell allocation.\n");
         exit(1);
     }
 
@@ -343,110 +1082,510 @@ void validation(int argc, char **argv, struct gol_data* data){
     else{
         data->print = atoi(argv[5]);
     }
+
+    //the options say how to read some files (-b), so they come first
+    parse_options(argc, argv, data);
+
+    //the loader reads the file on the workers, so they are started first
+    data->threads = atoi(argv[3]);
+    if (data->threads < 1) {
+        printf("Please use at least one thread.\n");
+        exit(1);
+    }
+    workers = pool_create(data->threads, data->pin);
+
+    int ret = init_game_data_from_args(data, argv);
+    if (ret != 0) {
+        printf("Initialization error: file %s\n", argv[1]);
+        exit(1);
+    }
+    if (!data->batch) {
+        check_threads(data);
+    }
 }
 
-/* this function initializes the partition for threads.
-it takes care of row wise and column wise partitioning.
-    data: pointer to gol_data struct to initialize
-    targs: threads info 
-    no returns*/
-void partition(struct gol_data *data, pthread_t *tid, struct gol_data* targs){
-    //base work is the number of rows or columns needed divided evenly across
-    //threads, extra work divides the remaining threads across the first
-    //few threads
-    int base_work, extra_work = 0;
+/* check that the board has enough rows, columns or cells for every
+ * thread to get a part of it in the chosen partition mode
+ * data: pointer to gol_data struct with the board and settings loaded */
+void check_threads(struct gol_data* data){
+    if(data->divide_mode == 0){
+        //column-wise grid cell allocation
+        if(data->threads > data->cols){
+            printf("Number of threads must be less than number of colunns.\n");
+            exit(1);
+        }
+    }
 
-    if (data->divide_mode == 0){
-        // col mode
-        base_work = data->cols/data->threads;
-        if (data->cols%data->threads == 0){
-            data->mini_cols = base_work;
-        } else{
-            data->mini_cols = base_work;
-            extra_work = data->cols%data->threads;
+    else if(data->divide_mode == 1){
+        //row-wise grid cell allocation
+        if(data->threads > data->rows){
+            printf("Number of threads must be less than number of rows.\n");
+            exit(1);
         }
+    }
 
-        for (int i = 0; i < data->threads; i++){
-            targs[i] = *data;
-            targs[i].id = i;
-            targs[i].mini_rows = data->rows;
-        }
-        //if there are remaining threads that werent divided evenly across
-        //cols
-        if (extra_work != 0){
-            for (int i = 0; i < extra_work; i++){
-                targs[i].mini_cols++;
-            } 
-        } 
-
-        int index = 0;
-        for (int i = 0; i < data->threads; i++){
-            targs[i].col_start = index;
-            index = index + targs[i].mini_cols;
-            targs[i].col_end = targs[i].col_start + targs[i].mini_cols -1 ;
-            targs[i].row_start = 0;
-            targs[i].row_end = data->rows -1 ;
-            
+    else if(data->divide_mode == 2){
+        //2D block allocation, needs at least one cell per thread
+        if((long)data->threads > (long)data->rows*data->cols){
+            printf("Number of threads must be less than number of cells.\n");
+            exit(1);
         }
+    }
+}
 
+/* parse the options that may follow the five required arguments, and
+ * collect any more input files given among them
+ * data: pointer to gol_data struct to initialize
+ * argv: command line args, options start at argv[6]
+ * argc: command line count */
+void parse_options(int argc, char **argv, struct gol_data* data){
+    const char *kernel_name = NULL;
+
+    data->engine = ENGINE_LIFE;
+    data->rule = RULE_CONWAY;
+    data->steps = 1;
+    data->spin = -1;
+    data->pin = 0;
+    data->checkpoint_every = -1;
+    data->board_rows = 0;
+    data->quiet = 0;
+    data->batch = 0;
+    data->max_period = 0;
+    data->verify = 0;
+    data->fps = FRAME_RATE;
+    data->frame_every = 0;
+    data->glyphs = isatty(STDERR_FILENO) ? TERM_FIT : ASCII_PLAIN;
+    data->stats = NULL;
+    data->stats_path = NULL;
+    data->stats_binary = 0;
+
+    data->inputs = malloc(sizeof(char *)*argc);
+    if (!data->inputs){
+        perror("malloc: inputs");
+        exit(1);
     }
+    data->inputs[0] = argv[1];
+    data->num_inputs = 1;
 
-    else {
-        // row mode
-        base_work = data->rows/data->threads;
-        if (data->rows%data->threads == 0){
-            data->mini_rows = base_work;
+    for (int i = 6; i < argc; i++){
+        if (strcmp(argv[i], "-k") == 0 && i+1 < argc){
+            kernel_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "-R") == 0 && i+1 < argc){
+            i++;
+            if (rule_parse(argv[i], &data->rule) != 0){
+                printf("Unknown rule: %s (B/S notation like B36/S23,"\
+                        " without B0, or a name like highlife)\n",
+                        argv[i]);
+                exit(1);
+            }
         }
-        else {
-            data->mini_rows = base_work;
-            extra_work = data->rows%data->threads;
+        else if (strcmp(argv[i], "-e") == 0 && i+1 < argc){
+            i++;
+            if (strcmp(argv[i], "life") == 0){
+                data->engine = ENGINE_LIFE;
+            } else if (strcmp(argv[i], "hashlife") == 0){
+                data->engine = ENGINE_HASHLIFE;
+            } else if (strcmp(argv[i], "sparse") == 0){
+                data->engine = ENGINE_SPARSE;
+            } else if (strcmp(argv[i], "auto") == 0){
+                data->engine = ENGINE_AUTO;
+            } else {
+                printf("Unknown engine: %s (options are life, hashlife,"\
+                        " sparse, auto)\n", argv[i]);
+                exit(1);
+            }
         }
-
-        for (int i = 0; i < data->threads; i++){
-            targs[i] = *data;
-            targs[i].id = i;
-            targs[i].mini_cols = data->cols;
-        }
-        //if there are remaining threads that werent divided evenly across
-        //rows
-        if (extra_work != 0){
-            for (int i = 0; i < extra_work; i++){
-                targs[i].mini_rows++;
+        else if (strcmp(argv[i], "-t") == 0 && i+1 < argc){
+            data->steps = atoi(argv[++i]);
+            //the halo around a tile is one word wide and must stay
+            //within the tiles next to it
+            if (data->steps < 1 || data->steps > TILE_ROWS){
+                printf("Steps per barrier must be from 1 to %d.\n",
+                        TILE_ROWS);
+                exit(1);
             }
         }
-        
-        int index = 0;
-        for (int i = 0; i < data->threads; i++){
-            targs[i].row_start = index;
-            index = index + targs[i].mini_rows;
-            targs[i].row_end = targs[i].row_start + targs[i].mini_rows -1 ;
-            targs[i].col_start = 0;
-            targs[i].col_end = data->rows -1 ;
+        else if (strcmp(argv[i], "-s") == 0 && i+1 < argc){
+            data->spin = atoi(argv[++i]);
+            if (data->spin < 0){
+                printf("The spin count can't be negative.\n");
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-C") == 0 && i+2 < argc){
+            data->checkpoint_every = atoi(argv[++i]);
+            data->checkpoint_path = argv[++i];
+            if (data->checkpoint_every < 0){
+                printf("The rounds between snapshots can't be negative.\n");
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i+3 < argc){
+            data->board_rows = atoi(argv[++i]);
+            data->board_cols = atoi(argv[++i]);
+            data->board_iters = atoi(argv[++i]);
+            if (data->board_rows < 1 || data->board_cols < 1 ||
+                    data->board_iters < 0){
+                printf("The board for -b needs rows and columns of at"\
+                        " least 1 and rounds of at least 0.\n");
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i+2 < argc){
+            i++;
+            if (strcmp(argv[i], "bin") == 0){
+                data->stats_binary = 1;
+            } else if (strcmp(argv[i], "csv") != 0){
+                printf("Unknown stats format: %s (options are csv, bin)\n",
+                        argv[i]);
+                exit(1);
+            }
+            data->stats_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i+1 < argc){
+            data->max_period = atoi(argv[++i]);
+            if (data->max_period < 1 || data->max_period > MAX_PERIOD){
+                printf("The longest period to look for must be from 1"\
+                        " to %d.\n", MAX_PERIOD);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-B") == 0){
+            data->batch = 1;
+        }
+        else if (strcmp(argv[i], "-V") == 0){
+            data->verify = 1;
+        }
+        else if (strcmp(argv[i], "-A") == 0 && i+1 < argc){
+            i++;
+            data->glyphs = term_glyphs(argv[i]);
+            if (strcmp(argv[i], "plain") == 0){
+                data->glyphs = ASCII_PLAIN;
+            } else if (data->glyphs < 0){
+                printf("Unknown glyphs: %s (options are cells, half,"\
+                        " braille, fit, plain)\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-E") == 0 && i+3 < argc){
+            i++;
+            data->frame_format = frames_format(argv[i]);
+            if (data->frame_format < 0){
+                printf("Unknown frame format: %s (options are ppm, pgm,"\
+                        " raw)\n", argv[i]);
+                exit(1);
+            }
+            data->frame_every = atoi(argv[++i]);
+            data->frame_path = argv[++i];
+            if (data->frame_every < 1){
+                printf("The rounds between frames must be at least 1.\n");
+                exit(1);
+            }
+            //the input file hasn't been loaded yet, or said so
+            if (strcmp(data->frame_path, "-") == 0){
+                frames_claim_stdout();
+            }
+        }
+        else if (strcmp(argv[i], "-F") == 0 && i+1 < argc){
+            data->fps = atof(argv[++i]);
+            if (data->fps < 0){
+                printf("The frame rate can't be negative.\n");
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-p") == 0){
+            data->pin = 1;
+        }
+        else if (argv[i][0] != '-'){
+            data->inputs[data->num_inputs++] = argv[i];
+        }
+        else{
+            printf("Unknown option: %s\n", argv[i]);
+            exit(1);
         }
     }
-    
 
-}
+    if (data->engine != ENGINE_LIFE &&
+            data->output_mode != OUTPUT_NONE){
+        printf("The hashlife, sparse and auto engines only run with"\
+                " output mode 0.\n");
+        exit(1);
+    }
 
-/* This function prints partition information, and it prints the 
-    thread id, which rows and columns each thread takes care of.
+    if (data->steps > 1 && (data->engine != ENGINE_LIFE ||
+                data->output_mode == OUTPUT_VISI)){
+        printf("-t only works with the life engine and output mode 0, 1"\
+                " or 3.\n");
+        exit(1);
+    }
 
-    args: pointer to type void, but will be casted to type gol_data struct 
-    the function returns null*/
-void *print_stats(void *args) {
-    //  based on user input, print the thread information
+    if (data->checkpoint_every >= 0 && data->engine != ENGINE_LIFE){
+        printf("-C only works with the life engine.\n");
+        exit(1);
+    }
 
-    struct gol_data *data;
-    data = (struct gol_data *)args;
+    //with -t, the rounds between barriers are never seen whole
+    if (data->stats_path && (data->engine != ENGINE_LIFE ||
+                data->steps > 1)){
+        printf("-S only works with the life engine and -t 1.\n");
+        exit(1);
+    }
 
+    if (data->max_period > 0 && (data->engine != ENGINE_LIFE ||
+                data->steps > 1 || data->output_mode == OUTPUT_VISI)){
+        printf("-c only works with the life engine, -t 1 and output"\
+                " mode 0, 1 or 3.\n");
+        exit(1);
+    }
 
-    printf("tid: %5d: rows: %5d:%5d \t(%d) cols: %5d:%5d (%d)\n",\
-     data->id, data->row_start, data->row_end, data->mini_rows\
-     , data->col_start, data->col_end, data->mini_cols);
-    
-    
-    return NULL;
-}
+    //a batch plays many boards side by side, with nothing to show and
+    //no game-wide rounds to save or watch
+    if (data->batch && (data->engine != ENGINE_LIFE ||
+                data->output_mode != OUTPUT_NONE || data->steps > 1 ||
+                data->checkpoint_every >= 0 || data->stats_path ||
+                data->max_period > 0)){
+        printf("-B only works with the life engine and output mode 0,"\
+                " without -t, -C, -S or -c.\n");
+        exit(1);
+    }
+
+    //the animation owns the threads until its window is closed, and a
+    //batch never has the whole game in one place
+    if (data->verify && (data->output_mode == OUTPUT_VISI ||
+                data->batch)){
+        printf("-V only works with output mode 0, 1 or 3, without -B.\n");
+        exit(1);
+    }
+
+    if ((data->output_mode == OUTPUT_FRAMES) != (data->frame_every > 0)){
+        printf("Output mode 3 needs -E, and -E needs output mode 3.\n");
+        exit(1);
+    }
+
+    //with -t, the board is only whole at the barriers
+    if (data->frame_every % data->steps != 0){
+        printf("The rounds between frames must be a multiple of -t's"\
+                " steps.\n");
+        exit(1);
+    }
+
+    //each game would overwrite the last one's frames
+    if (data->num_inputs > 1 && (data->output_mode == OUTPUT_VISI ||
+                data->output_mode == OUTPUT_FRAMES)){
+        printf("Only one input file can be played with output mode 2"\
+                " or 3.\n");
+        exit(1);
+    }
+
+    data->kernel = kernel_select(kernel_name, data->rule);
+    if (data->kernel == NULL){
+        printf("Kernel %s is unknown or not supported on this CPU.\n",
+                kernel_name);
+        exit(1);
+    }
+}
+
+/* This function splits n items into parts pieces as evenly as possible,
+the first few pieces taking one extra item when it doesn't divide evenly.
+    n: number of items
+    parts: number of pieces
+    i: which piece
+    start: set to the first item of piece i
+    returns the number of items in piece i (may be 0)*/
+static int split_work(int n, int parts, int i, int *start){
+    int base_work = n/parts;
+    int extra_work = n%parts;
+
+    *start = i*base_work + (i < extra_work ? i : extra_work);
+    return base_work + (i < extra_work ? 1 : 0);
+}
+
+/* This function picks the P x Q grid of blocks for 2D block mode. It tries
+every way of writing threads as P*Q (P rows of blocks, Q columns) and takes
+the one whose blocks have the shortest edges, so the blocks come out as
+close to square as the board allows and threads share as few cells along
+their block edges as possible. Columns are split on whole words, so Q is
+kept to at most the number of words in a row when possible.
+    data: pointer to gol_data struct, with rows, cols, words and threads
+    p, q: set to the number of rows and columns of blocks
+    no returns*/
+static void pick_block_grid(struct gol_data *data, int *p, int *q){
+    long best = -1, edge;
+    int height, width;
+
+    *p = data->threads;
+    *q = 1;
+    for (int i = 1; i <= data->threads; i++){
+        if (data->threads % i != 0){
+            continue;
+        }
+        height = (data->rows + i - 1)/i;
+        width = (data->grid.words + data->threads/i - 1)/(data->threads/i)*64;
+        width = (width > data->cols) ? data->cols : width;
+        edge = (long)height + width;
+        //grids with more blocks than rows or words leave threads idle
+        if (i > data->rows || data->threads/i > data->grid.words){
+            edge += (long)data->rows + data->cols;
+        }
+        if (best < 0 || edge < best){
+            best = edge;
+            *p = i;
+            *q = data->threads/i;
+        }
+    }
+}
+
+/* this function initializes the partition for threads.
+it takes care of row wise, column wise and 2D block partitioning: the
+board is cut into a P x Q grid of blocks, one per thread, where column
+strips are 1 x threads, row strips are threads x 1, and 2D blocks pick P
+and Q from the board shape (see pick_block_grid). Columns are split into
+whole 64-bit words of the packed board, so two threads never write to
+the same word; a thread may end up with no columns if there are more
+threads than words in a row.
+    data: pointer to gol_data struct to initialize
+    targs: threads info 
+    no returns*/
+void partition(struct gol_data *data, pthread_t *tid, struct gol_data* targs){
+    int word_start, mini_words;
+
+    if (data->divide_mode == 0){
+        // col mode
+        data->grid_p = 1;
+        data->grid_q = data->threads;
+    }
+    else if (data->divide_mode == 1){
+        // row mode
+        data->grid_p = data->threads;
+        data->grid_q = 1;
+    }
+    else {
+        // 2D block mode
+        pick_block_grid(data, &data->grid_p, &data->grid_q);
+    }
+
+    for (int i = 0; i < data->threads; i++){
+        targs[i] = *data;
+        targs[i].id = i;
+        //threads fill the grid of blocks row by row
+        targs[i].block_r = i/data->grid_q;
+        targs[i].block_c = i%data->grid_q;
+
+        targs[i].mini_rows = split_work(data->rows, data->grid_p,
+                targs[i].block_r, &targs[i].row_start);
+        targs[i].row_end = targs[i].row_start + targs[i].mini_rows - 1;
+
+        mini_words = split_work(data->grid.words, data->grid_q,
+                targs[i].block_c, &word_start);
+        targs[i].word_start = word_start;
+        targs[i].word_end = word_start + mini_words - 1;
+
+        //the cells those words hold; the last word may be partly used
+        targs[i].col_start = targs[i].word_start*64;
+        targs[i].col_end = (targs[i].word_end+1)*64 - 1;
+        if (targs[i].col_end > data->cols - 1){
+            targs[i].col_end = data->cols - 1;
+        }
+        if (targs[i].col_start > data->cols - 1){
+            targs[i].col_start = data->cols;
+        }
+        targs[i].mini_cols = targs[i].col_end - targs[i].col_start + 1;
+    }
+}
+
+/* This function prints partition information, and it prints the 
+    thread id, which rows and columns each thread takes care of, in
+    2D block mode which block of the P x Q grid it has, and which CPU
+    and NUMA node the thread is on.
+
+    args: pointer to type void, but will be casted to type gol_data struct 
+    the function returns null*/
+void *print_stats(void *args) {
+    //  based on user input, print the thread information
+
+    struct gol_data *data;
+    int cpu, node;
+    data = (struct gol_data *)args;
+
+
+    printf("tid: %5d: rows: %5d:%5d \t(%d) cols: %5d:%5d (%d)",\
+     data->id, data->row_start, data->row_end, data->mini_rows\
+     , data->col_start, data->col_end, data->mini_cols);
+    //in 2D block mode, also say where the block sits in the grid
+    if (data->divide_mode == 2){
+        printf(" block: (%d,%d) of %dx%d", data->block_r, data->block_c,
+                data->grid_p, data->grid_q);
+    }
+    //where the thread runs, and whether it is held there
+    pool_where(&cpu, &node);
+    printf(" cpu: %d node: %d%s", cpu, node, data->pin ? " (pinned)" : "");
+    printf("\n");
+    
+    
+    return NULL;
+}
+
+/* This function gives every tile of the board to the thread whose part
+of the board (from partition) has the tile's top left cell, and sets up
+the tile queues the threads start each round with. Threads that finish
+their own tiles steal from the others, so the partition only decides
+where each thread starts.
+    data: pointer to gol_data struct
+    targs: threads info, already partitioned
+    no returns*/
+void assign_tiles(struct gol_data *data, struct gol_data *targs){
+    int tiles = data->tiles_r*data->tiles_c;
+    int *owner, row, word;
+
+    queues = aligned_alloc(64, sizeof(struct tile_queue)*data->threads);
+    owner = malloc(sizeof(int)*tiles);
+    if (!queues || !owner){ perror("malloc: tile queues"); exit(1); }
+
+    for (int t = 0; t < tiles; t++){
+        row = (t/data->tiles_c)*TILE_ROWS;
+        word = (t%data->tiles_c)*TILE_WORDS;
+        owner[t] = 0;
+        for (int i = 0; i < data->threads; i++){
+            if (row >= targs[i].row_start && row <= targs[i].row_end &&
+                    word >= targs[i].word_start &&
+                    word <= targs[i].word_end){
+                owner[t] = i;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < data->threads; i++){
+        queues[i].count = 0;
+        queues[i].ends = 0;
+        queues[i].tiles = malloc(sizeof(int)*(tiles ? tiles : 1));
+        if (!queues[i].tiles){ perror("malloc: tile queue"); exit(1); }
+        for (int t = 0; t < tiles; t++){
+            if (owner[t] == i){
+                queues[i].tiles[queues[i].count++] = t;
+            }
+        }
+        targs[i].tiles_done = 0;
+        targs[i].tiles_skipped = 0;
+        targs[i].tiles_stolen = 0;
+    }
+    free(owner);
+}
+
+/* This function prints how many tiles each thread updated over the whole
+    run, how many it skipped because nothing around them changed, and how
+    many of those it stole from other threads.
+    targs: threads info
+    threads: number of threads
+    no returns*/
+void print_tile_stats(struct gol_data *targs, int threads){
+    for (int i = 0; i < threads; i++){
+        printf("tid: %5d: tiles: %8d updated %8d skipped %8d stolen\n",
+                targs[i].id, targs[i].tiles_done, targs[i].tiles_skipped,
+                targs[i].tiles_stolen);
+    }
+}
 
 /* initialize the gol game state from command line arguments
  *       argv[1]: name of file to read game config state from
@@ -459,127 +1598,402 @@ void *print_stats(void *args) {
  */
 int init_game_data_from_args(struct gol_data *data, char **argv) {
 
-    int temp;
-
-    // (1) declare a FILE * variable
-    //     A file pointer is not a pointer like pointers to other
-    //     C types: dereferencing it doesn't make any sense.
-
-    FILE *infile;
-    infile = fopen(argv[1], "r");
-
-    // (2) open the file for reading and check that open succeeded
-    //     (the file name is passed as command line arg)
-    if (infile == NULL) { 
-        printf("Error: failed to open file: %s\n", argv[1]);
-        exit(1);
-    }
-
-    // (3) read in some values from the file using fscanf
-    //     fscanf is like scanf, except that it takes a FILE *
-    //     to the file from which to read as its first argument
-    //     it returns the number of items read (or fewer on EOF or error)
-    temp = openfile(data, infile);
-    
-    if (temp ==1){
-        printf("error opening file");
-        exit(1);
-    }
-
     int runmode = atoi(argv[2]);
 
     //spits error if runmode is not one of the valid options
-    if (runmode > 3){
+    if (runmode < 0 || runmode > 3){
         printf("Incorrect run mode entered. options are (0: no visualization,"\
-            " 1: ASCII, 2: ParaVisi)\n");
+            " 1: ASCII, 2: ParaVisi, 3: frames)\n");
         exit(1);
     }
 
     data->output_mode = runmode;
-    
-    make_world(data, argv, infile);
     //initializing divide mode and thread number based on user input
     data->divide_mode = atoi(argv[4]);
     data->threads = atoi(argv[3]);
 
+    //a batch list is read when the batch is played
+    if (!data->batch) {
+        load_game(data, argv[1]);
+    }
+
     return 0;
 }
 
+/* read a game from an input file: the board size, the number of rounds
+ * and the live cells, and set up the world (see make_world). The file is
+ * either a coordinate list or an RLE pattern, which is put in the middle
+ * of the board given with -b, and is parsed on the data->threads workers
+ * (see loader.h), or in a batch on the worker playing the board. It may
+ * also be a snapshot, which is loaded with load_snapshot instead.
+ * param data: pointer to gol_data struct, with threads and the options set
+ * param path: name of the file to read game config state from
+ * no returns
+ */
+void load_game(struct gol_data *data, const char *path) {
+
+    struct load_header hdr;
+    struct timeval start_time, stop_time;
+    struct rule rule;
+    char name[24];
+    const char *text;
+    size_t len;
+    int top = 0, left = 0;
+    double secs;
+
+    data->generation = 0;
+    if (snapshot_is(path)) {
+        load_snapshot(data, path);
+        return;
+    }
+
+    gettimeofday(&start_time, NULL);
+
+    //the file is mapped in and read in place, rather than with fscanf
+    text = load_map(path, &len);
+    if (load_header(text, len, &hdr) != 0) {
+        printf("Improper file format: %s\n", path);
+        exit(1);
+    }
+
+    if (hdr.format == LOAD_RLE) {
+        if (data->board_rows == 0) {
+            printf("%s is an RLE pattern, give a board for it with"\
+                    " -b rows cols rounds\n", path);
+            exit(1);
+        }
+        if (hdr.rule[0] != '\0' && (rule_parse(hdr.rule, &rule) != 0 ||
+                    rule.birth != data->rule.birth ||
+                    rule.survive != data->rule.survive)) {
+            rule_format(data->rule, name);
+            printf("%s uses rule %s, but the game is played by %s"\
+                    " (see -R).\n", path, hdr.rule, name);
+            exit(1);
+        }
+        if (hdr.height > data->board_rows || hdr.width > data->board_cols) {
+            printf("The %dx%d pattern in %s doesn't fit on the %dx%d"\
+                    " board.\n", hdr.height, hdr.width, path,
+                    data->board_rows, data->board_cols);
+            exit(1);
+        }
+        data->rows = data->board_rows;
+        data->cols = data->board_cols;
+        data->iters = data->board_iters;
+        top = (data->rows - hdr.height)/2;
+        left = (data->cols - hdr.width)/2;
+    } else {
+        data->rows = hdr.rows;
+        data->cols = hdr.cols;
+        data->iters = hdr.iters;
+    }
+
+    make_world(data);
+    load_cells(text, len, &hdr, path, grid_row(&data->grid, data->world, 0),
+            data->grid.stride, data->rows, data->cols, top, left,
+            data->batch ? NULL : workers, data->threads);
+    load_unmap(text, len);
+
+    //count the cells rather than trusting the file, which may list a
+    //cell twice
+    data->live = (int)grid_count(&data->grid, data->world);
+    grid_fill_ghosts(&data->grid, data->world);
+
+    gettimeofday(&stop_time, NULL);
+    secs = (stop_time.tv_sec - start_time.tv_sec) +
+        (stop_time.tv_usec - start_time.tv_usec)/1000000.0;
+    if (!data->quiet) {
+        printf("Loaded %s: %.1f MB in %.3f seconds (%.1f MB/s)\n", path,
+                len/1e6, secs, (secs > 0) ? len/1e6/secs : 0.0);
+    }
+}
+
 /* initialize the world and world copy that will be used to store copies
- * of the world array.
-    uses the file name to open the file and save number of coordinate pairs.
-    reads in the live coordinate pairs from the file and initializes
-    those coordinates with a value of 1, indicating alive
+ * of the world array. Both are laid out as grid.h describes: bit-packed,
+ * with a one-cell ghost border, which load_game fills in once the live
+ * cells are read.
+ * param data: pointer to gol_data struct with rows and cols set
+ * no returns
+ */
+void make_world(struct gol_data *data){
+    grid_init(&data->grid, data->rows, data->cols);
+    //makes one world array, initialized to all dead cells
+    data->world = grid_alloc(&data->grid);
+    //makes an alternate world array to temporarily store changes
+    data->world_copy = grid_alloc(&data->grid);
+    make_tiles(data);
+}
+
+/* This function sets up the grid of tiles over the board, with every
+ * tile marked as changed in round 0 so the first round updates them all.
+ * param data: pointer to gol_data struct with rows and words set
+ * no returns
+ */
+void make_tiles(struct gol_data *data){
+    data->tiles_r = (data->rows + TILE_ROWS - 1)/TILE_ROWS;
+    data->tiles_c = (data->grid.words + TILE_WORDS - 1)/TILE_WORDS;
+    data->tile_stamp = calloc((size_t)data->tiles_r*data->tiles_c,
+            sizeof(int));
+    if (!data->tile_stamp){
+        perror("calloc: tile_stamp");
+        exit(1);
+    }
+}
+
+/* This function loads a game saved as a snapshot (see snapshot.h). The
+ * snapshot's board, ghost cells and all, is mapped in as world without
+ * being copied or parsed; pages the game writes are copied privately, so
+ * the file is never changed. The game goes on from the round it was
+ * saved at, for the rounds it has left.
  * param data: pointer to gol_data struct
- * param argv: command line args
- *       argv[1]: name of file to read game config state from
- *       argv[2]: run mode
+ * param path: name of the snapshot file
  * no returns
  */
-void make_world(struct gol_data *data, char **argv, FILE *infile){
-    char filename;
-    strcpy(&filename, argv[1]);
-    
-    int ret, sets, i, r, c;
-    //reads in number of coordinate pairs from file
-    ret = fscanf(infile, "%d", &sets);
-    //makes one world array
-    data->world = malloc(sizeof(int)*data->rows*data->cols);
+void load_snapshot(struct gol_data *data, const char *path){
+    struct snapshot_header hdr;
+    struct rule rule;
+    char name[24], played[24];
+
+    data->world = snapshot_map(path, &hdr);
+    //a game goes on by the rule it was saved under, or not at all
+    rule.birth = hdr.birth;
+    rule.survive = hdr.survive;
+    if (rule.birth != data->rule.birth ||
+            rule.survive != data->rule.survive){
+        rule_format(rule, name);
+        rule_format(data->rule, played);
+        printf("%s uses rule %s, but the game is played by %s"\
+                " (see -R).\n", path, name, played);
+        exit(1);
+    }
+    data->rows = hdr.rows;
+    data->cols = hdr.cols;
+    //snapshot_map made sure the board is laid out the same way
+    grid_init(&data->grid, hdr.rows, hdr.cols);
+    data->generation = (int)hdr.generation;
+    data->iters = (int)(hdr.iters - hdr.generation);
+    data->live = (int)hdr.live;
+
     //makes an alternate world array to temporarily store changes
-    data->world_copy = malloc(sizeof(int)*data->rows*data->cols);
-        //initialize the entire array to be 0
-    for(int i=0; i<data->rows; i++){
-        for(int j=0; j<data->cols; j++){
-            data->world[j*data->rows+i] = 0; 
+    data->world_copy = grid_alloc(&data->grid);
+    make_tiles(data);
+}
+
+/* This function makes a random board for benchmarks, where each cell is
+ * alive with chance density. The numbers come from splitmix64 rather than
+ * rand, so a seed gives the same board on every machine and C library.
+ * param data: pointer to gol_data struct with rows and cols set
+ * param density: chance that a cell starts out alive, from 0 to 1
+ * param seed: seed for the random numbers
+ * no returns
+ */
+void random_world(struct gol_data *data, double density,
+        unsigned long seed){
+    uint64_t state = seed, z, *row;
+    //a cell is alive if its 53 random bits are below this
+    uint64_t below = (uint64_t)(density*(double)(1ULL << 53));
+    int r, c;
+
+    make_world(data);
+    data->live = 0;
+    for (r = 0; r < data->rows; r++){
+        row = grid_row(&data->grid, data->world, r);
+        for (c = 0; c < data->cols; c++){
+            state += 0x9e3779b97f4a7c15ULL;
+            z = state;
+            z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+            z = z ^ (z >> 31);
+            if ((z >> 11) < below){
+                grid_set_bit(row, c);
+                data->live++;
+            }
         }
     }
-    
-    i = 0;
-    ret = 2;
+    grid_fill_ghosts(&data->grid, data->world);
+}
 
-    total_live = sets;
-    
-    while((i<sets)&&(ret == 2)){
-        //reads in coordintates, two values at a time
-        //stores in the first value to row, second value to column
-        ret = fscanf(infile, "%d%d", &r, &c);
-        //if there are less than two integer values that are read in at
-        //any time, throw error. (invalid input)
-        if (ret != 2){
-            printf("Error: Missing input %s\n", &filename);
+/* This function opens the statistics stream for -S, if it was asked for,
+ * and writes the CSV header. One stream covers every input file; each
+ * game starts over with a record for its starting board.
+ * param data: pointer to gol_data struct with the options parsed
+ * no returns
+ */
+void open_stats(struct gol_data *data){
+    if (!data->stats_path){
+        return;
+    }
+    if (strcmp(data->stats_path, "-") == 0){
+        data->stats = stdout;
+    } else {
+        data->stats = fopen(data->stats_path, data->stats_binary ? "wb" : "w");
+        if (!data->stats){
+            printf("Error: failed to open file: %s\n", data->stats_path);
             exit(1);
         }
-        //set coordinate to alive
-        data->world[data->cols*r+c] = 1;
-        i++;
+    }
+    if (!data->stats_binary){
+        fprintf(data->stats, "generation,population,births,deaths\n");
     }
 }
 
-/* This function read in the provided file, and check for proper type inputs
- * param: filename (char): name of file
- *        data (struct gol_data): pointer to struct gol_data
- *        infile (FILE): pointer to type FILE
- * return: 0 if successful
- *         1 if failure
+/* This function writes one record to the statistics stream, if there is
+ * one. Thread 0 calls it before the first round and after adding up each
+ * round. Births are counted by the kernels as they go (see kernel.h), so
+ * deaths are whatever is left of the change in live cells.
+ * param data: pointer to thread 0's struct gol_data
+ * param round: rounds played in this run
+ * param births: cells that came alive in the round
+ * param delta: change in live cells in the round
+ * no returns
  */
-int openfile(struct gol_data *data, FILE *infile){
-    
-    int ret = fscanf(infile, "%d", &data->rows); // Checking valid type
-    if (ret == 0) {
-        printf("Improper file format.\n");
-        exit(1);
+void write_stats(struct gol_data *data, int round, int births, int delta){
+    struct gol_stats record;
+
+    if (!data->stats){
+        return;
     }
-    ret = fscanf(infile, "%d", &data->cols);
-    if (ret == 0) {
-        printf("Improper file format.\n");
-        exit(1);
+    record.generation = data->generation + round;
+    record.population = total_live;
+    record.births = births;
+    record.deaths = births - delta;
+    if (data->stats_binary){
+        if (fwrite(&record, sizeof(record), 1, data->stats) != 1){
+            perror("fwrite: stats");
+            exit(1);
+        }
+    } else {
+        fprintf(data->stats, "%lld,%lld,%lld,%lld\n",
+                (long long)record.generation, (long long)record.population,
+                (long long)record.births, (long long)record.deaths);
     }
-    ret = fscanf(infile, "%d", &data->iters);
-    if (ret == 0) {
-        printf("Improper file format.\n");
-        exit(1);
+}
+
+/* This function saves the board as a snapshot if the game just went past
+ * a multiple of -C rounds (or, for -C 0, if no round has been played
+ * yet). Thread 0 calls it before the first round and after each barrier,
+ * once it has added up the live cells: the other threads only read world
+ * until the next barrier, so it stays still while it is written out.
+ * param data: pointer to thread 0's struct gol_data
+ * param before, after: rounds played in this run before and after the
+ *        last barrier
+ * no returns
+ */
+void write_checkpoint(struct gol_data *data, int before, int after){
+    struct snapshot_header hdr;
+    int every = data->checkpoint_every;
+
+    if (every < 0 || (every == 0 && after > 0)){
+        return;
+    }
+    //rounds count from the start of the game, so a resumed game goes on
+    //writing snapshots at the same rounds
+    before += data->generation;
+    after += data->generation;
+    if (every > 0 && after/every == before/every){
+        return;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SNAPSHOT_MAGIC;
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.header_size = SNAPSHOT_HEADER;
+    hdr.rows = data->rows;
+    hdr.cols = data->cols;
+    hdr.words = data->grid.words;
+    hdr.stride = data->grid.stride;
+    hdr.iters = data->generation + data->iters;
+    hdr.generation = after;
+    hdr.live = total_live;
+    hdr.birth = data->rule.birth;
+    hdr.survive = data->rule.survive;
+    snapshot_write(data->checkpoint_path, &hdr,
+            grid_row(&data->grid, data->world, -1) - 1);
+}
+
+/* What a worker needs to first touch its part of the boards */
+struct place_job {
+    struct gol_data *data;  // the worker's own struct gol_data
+    uint64_t *from;         // the board as load_game read it
+    uint64_t *to;           // the new board, not touched yet
+};
+
+/* This function is run by every worker, pinned to its CPU, before the
+ * game: it copies the rows of its own tiles (the ones assign_tiles gave
+ * it) from the board load_game read into the new board, and zeros the
+ * same rows of world_copy, which nobody has touched yet. Being the first
+ * to write those pages puts them on the worker's node. The ghost words at
+ * either end of a row go with the tile next to them.
+ * param args: pointer to the worker's struct place_job
+ */
+static void *touch_tiles(void *args){
+    struct place_job *job = (struct place_job *)args;
+    struct gol_data *data = job->data;
+    struct tile_queue *mine = &queues[data->id];
+    int t, r0, r1, k0, k1;
+
+    for (int n = 0; n < mine->count; n++){
+        t = mine->tiles[n];
+        r0 = (t/data->tiles_c)*TILE_ROWS;
+        r1 = r0 + TILE_ROWS - 1;
+        k0 = (t%data->tiles_c)*TILE_WORDS;
+        k1 = k0 + TILE_WORDS - 1;
+        r1 = (r1 > data->rows-1) ? data->rows-1 : r1;
+        k1 = (k1 > data->grid.words-1) ? data->grid.words-1 : k1;
+        k0 = (k0 == 0) ? -1 : k0;
+        k1 = (k1 == data->grid.words-1) ? data->grid.words : k1;
+
+        for (int r = r0; r <= r1; r++){
+            memcpy(grid_row(&data->grid, job->to, r) + k0,
+                    grid_row(&data->grid, job->from, r) + k0,
+                    sizeof(uint64_t)*(k1-k0+1));
+            memset(grid_row(&data->grid, data->world_copy, r) + k0, 0,
+                    sizeof(uint64_t)*(k1-k0+1));
+        }
+    }
+    return NULL;
+}
+
+/* This function moves the boards onto the NUMA nodes of the threads that
+ * update them, for -p. load_game filled in world on threads that aren't
+ * pinned, so its pages sit on whichever nodes those ran on. Each (pinned)
+ * worker copies its own tiles into a fresh board and touches its tiles
+ * of world_copy (see touch_tiles); then the fresh board replaces world.
+ * Tiles that get stolen during the game are read from another node, but
+ * most of a thread's tiles are its own.
+ * param data: pointer to gol_data struct with the board loaded
+ * param targs: threads info, from partition and assign_tiles
+ * param pool: the worker pool, pinned
+ * no returns
+ */
+void place_world(struct gol_data *data, struct gol_data *targs,
+        struct pool *pool){
+    struct place_job *jobs;
+    uint64_t *to = grid_alloc(&data->grid);
+
+    jobs = malloc(sizeof(struct place_job)*data->threads);
+    if (!jobs){ perror("malloc: place jobs"); exit(1); }
+    for (int i = 0; i < data->threads; i++){
+        jobs[i].data = &targs[i];
+        jobs[i].from = data->world;
+        jobs[i].to = to;
+    }
+    pool_start(pool, touch_tiles, jobs, sizeof(struct place_job));
+    pool_wait(pool);
+    free(jobs);
+
+    //the two ghost rows are small; they stay where they fall
+    memcpy(grid_row(&data->grid, to, -1) - 1,
+            grid_row(&data->grid, data->world, -1) - 1,
+            sizeof(uint64_t)*data->grid.stride);
+    memcpy(grid_row(&data->grid, to, data->rows) - 1,
+            grid_row(&data->grid, data->world, data->rows) - 1,
+            sizeof(uint64_t)*data->grid.stride);
+
+    grid_free(&data->grid, data->world);
+    data->world = to;
+    for (int i = 0; i < data->threads; i++){
+        targs[i].world = to;
     }
-    return 0;
 }
 
 /**************************************************************/
@@ -587,7 +2001,7 @@ int openfile(struct gol_data *data, FILE *infile){
 /* This function is the gol application main loop function:
  *  runs rounds of GOL,
  *    * updates program state for next round (world and total_live)
- *    * performs any animation step based on the output/run mode
+ *    * hands the board to the renderer when there is an animation
  *
  *   param data: pointer to a struct gol_data  initialized with
  *         all GOL game playing state
@@ -597,7 +2011,8 @@ void *play_gol(void *args) {
     //  at the end of each round of GOL, determine if there is an
     //  animation step to take based on the output_mode,
 
-    int i;
+    int i, steps;
+    int pending = -1;   // round of the frame encoded but not yet written
     struct gol_data *data;
     data = (struct gol_data *)args;
 
@@ -605,210 +2020,667 @@ void *play_gol(void *args) {
         print_stats(data);
     }
 
-    //runmode 0 gol: no output
-    if (data->output_mode == 0){
-        for(i = 0; i < data->iters; i++){
+    //two tiles with their halo, for playing several rounds per barrier;
+    //allocated here so the memory is close to the thread that uses it
+    data->block_buf = NULL;
+    if (data->steps > 1){
+        data->block_buf = calloc((size_t)2*(TILE_ROWS + 2*data->steps)*
+                (TILE_WORDS + 4), sizeof(uint64_t));
+        if (!data->block_buf){
+            perror("calloc: block_buf");
+            exit(1);
+        }
+    }
 
-            update_cells(data);
-            // Wait for everyone to finish rendering 1 round
-            pthread_barrier_wait(&done);
+    if (data->id == 0){
+        write_checkpoint(data, 0, 0);
+        write_stats(data, 0, 0, 0);
+        find_cycle(data, 0);
+    }
+    TRACE_START(data->id);
+
+    //frames for output mode 3 are encoded by every thread, each its own
+    //part, right after a barrier, and thread 0 writes one out after the
+    //next barrier, when all of its parts are in; frames take turns in two
+    //buffers, so the next one can be encoded while one is written
+    if (frames){
+        encode_frame(data, 0);
+        pending = 0;
+    }
 
+    //every output mode plays the rounds the same way: the animations
+    //are drawn by the renderer's own thread (see render.h), and thread 0
+    //only hands it a copy of the board when it is ready for one, so
+    //drawing never holds up the rounds
+    //(stop_round only changes before a barrier the threads have yet to
+    //pass, so they all see the same value in the same round)
+    for(i = 0; i < __atomic_load_n(&stop_round, __ATOMIC_RELAXED);
+            i += steps){
+        //the last barrier may come after fewer rounds
+        steps = data->iters - i;
+        steps = (steps > data->steps) ? data->steps : steps;
+
+        update_cells(data, steps);
+        TRACE_MARK(data->id, TRACE_COMPUTE, i);
+        // Wait for everyone to finish rendering 1 round
+        pool_barrier_wait(&done);
+        TRACE_MARK(data->id, TRACE_BARRIER, i);
+        if (data->id == 0 && pending >= 0){
+            frames_write(frames, (pending/data->frame_every) % 2,
+                    data->generation + pending);
+            TRACE_MARK(data->id, TRACE_OUTPUT, i);
+        }
+        pending = -1;
+        if (data->id == 0){
+            reduce_live(data, i + steps);
+            write_checkpoint(data, i, i + steps);
+            TRACE_MARK(data->id, TRACE_SERIAL, i);
+            //the other threads are writing world_copy by now, so world
+            //holds still until the next barrier
+            if (renderer){
+                render_publish(renderer, data->world, i + steps, total_live);
+                TRACE_MARK(data->id, TRACE_OUTPUT, i);
+            }
+        }
+        if (frames && (i + steps) % data->frame_every == 0){
+            encode_frame(data, i + steps);
+            TRACE_MARK(data->id, TRACE_OUTPUT, i);
+            pending = i + steps;
+        }
+    }
+    if (data->id == 0 && renderer){
+        render_last(renderer, data->world, i, total_live);
+    }
+    //the last frame needs one more barrier before it is whole
+    if (pending >= 0){
+        pool_barrier_wait(&done);
+        if (data->id == 0){
+            frames_write(frames, (pending/data->frame_every) % 2,
+                    data->generation + pending);
         }
     }
 
-    //runmode 1 gol: ascii output
-    //     (a) call system("clear") to clear previous world state from terminal
-    //     (b) call print_board function to print current world state
-    //     (c) call usleep(SLEEP_USECS) to slow down the animation
-    if (data->output_mode == 1){
-        for(i = 1; i < data->iters+1; i++){
-            update_cells(data);
-            pthread_barrier_wait(&done);
-            
-            // Needs syncing or else jumpled on top of each other
+    free(data->block_buf);
+    data->block_buf = NULL;
+    
+    return NULL;
+}
 
-            if (data->id == 0){
 
-                system("clear");
-                print_board(data, i);
-            }
-            pthread_barrier_wait(&done);
+/* This function encodes this thread's part of the board into the frame
+ * buffer for round, in the thread's color as ParaVisi would show it.
+ * Every thread calls it right after the barrier at the end of the round.
+ * param data: pointer to this thread's struct gol_data
+ * param round: the round just played, a multiple of data->frame_every
+ */
+static void encode_frame(struct gol_data *data, int round){
+    color3 color = colors[data->id%8];
+    uint8_t dead[3] = { color.r, color.g, color.b };
+
+    frames_encode(frames, (round/data->frame_every) % 2, data->world,
+            data->row_start, data->row_end, data->col_start, data->col_end,
+            dead);
+}
 
-            usleep(SLEEP_USECS);
-        }   
+/* This function adds up every thread's live cell change for the round
+ * thread 0 just finished and applies it to total_live, and writes the
+ * round's statistics for -S. Only thread 0 calls it, right after the
+ * barrier at the end of the round.
+ * param data: pointer to thread 0's struct gol_data
+ * param round: rounds played in this run, counting the one just finished
+ */
+static void reduce_live(struct gol_data *data, int round){
+    struct live_slot *slots;
+    int delta = 0, births = 0;
+
+    slots = live_slots + ((data->round-1) & 1)*data->threads;
+    for (int i = 0; i < data->threads; i++){
+        delta += slots[i].delta;
+        births += slots[i].births;
     }
-    
-    //   if ParaVis animation:
-    //     (a) call your function to update the color3 buffer
-    //     (b) call draw_ready(data->handle)
-    //     (c) call usleep(SLEEP_USECS) to slow down the animation
-    if (data->output_mode == 2){
-        for(i = 1; i <= data->iters; i++){
-            update_cells(data);
-            pthread_barrier_wait(&done);
+    total_live += delta;
+    write_stats(data, round, births, delta);
+    if (data->max_period > 0){
+        for (int i = 0; i < data->threads; i++){
+            total_hash ^= slots[i].hash;
+        }
+        find_cycle(data, round);
+    }
+}
 
-            update_colors(data);
-            pthread_barrier_wait(&done);
+/* This function checks whether the board is back to how it was up to
+ * max_period rounds ago, and if it is, cuts the game short: from then
+ * on the board goes around the same cycle, so only the rounds it takes
+ * to reach the phase of the cycle the last round would be in are still
+ * played, and the final board is the same as if all of them were.
+ * Boards are told apart by board_hash and live count, so two boards
+ * would have to agree on both, by chance, to be mixed up.
+ * Only thread 0 calls it, after adding up each round.
+ * param data: pointer to thread 0's struct gol_data
+ * param round: rounds played in this run
+ */
+static void find_cycle(struct gol_data *data, int round){
+    struct cycle_entry *seen;
+    int n = data->max_period, stop;
 
-            draw_ready(data->handle);
-            usleep(SLEEP_USECS);
+    if (n == 0 || cycle_period > 0){
+        return;
+    }
+    for (int d = 1; d <= n && d <= round && round < data->iters; d++){
+        seen = &history[(round - d) % n];
+        if (seen->hash == total_hash && seen->live == total_live){
+            cycle_round = round;
+            cycle_period = d;
+            //the other threads may already be playing round + 1, so
+            //stop no earlier than after it
+            stop = round + 1 + (data->iters - round - 1) % d;
+            __atomic_store_n(&stop_round, stop, __ATOMIC_RELAXED);
+            return;
         }
     }
-    
-    return NULL;
+    history[round % n].hash = total_hash;
+    history[round % n].live = total_live;
 }
 
-
-/* This function updates the cells, checking if they are alive or
- * dead based on the number of neighbors the cell has. this function
- * checks if the cells are alive in the world, but updates their
- * live or dead status in the world_copy, as to not disrupt future 
- * cells that still must be checked in world. (disrupt by prematurely
- * changing life status)
- * param data: pointer to a struct gol_data  initialized with
+/* This function plays all of the rounds with the HashLife engine
+ * instead of play_gol, on the calling thread, and updates world and
+ * total_live to the final round.
+ *   param data: pointer to a struct gol_data  initialized with
  *         all GOL game playing state
- *  no returns
+ *  no return
  */
-void update_cells(struct gol_data *data){
-    
-    int *temp;
-    
-    int i, j, num_neighbors;
+void play_hashlife(struct gol_data *data) {
+    total_live = (int)hashlife_run(grid_row(&data->grid, data->world, 0),
+            data->rows, data->cols, data->grid.stride, data->iters,
+            data->rule);
+    grid_fill_ghosts(&data->grid, data->world);
+}
+
+/* This function plays rounds of a game with the sparse engine on the
+ * calling thread: it copies the board into a sparse board, plays it
+ * round by round for as long as the board stays below density, and
+ * copies it back, updating total_live as it goes.
+ *   param data: pointer to a struct gol_data with the board loaded
+ *   param world: the board to play, which gets the final round
+ *   param rounds: most rounds to play
+ *   param density: stop early once more than this part of the cells are
+ *         alive (1 plays all of the rounds)
+ *   returns the number of rounds played
+ */
+static int play_sparse(struct gol_data *data, uint64_t *world, int rounds,
+        double density){
+    struct sparse *s = sparse_create(data->rows, data->cols,
+            data->kernel->row);
+    long most = (long)(density*data->rows*data->cols);
+    int i;
 
-    //change in live cell count
-    int mylivecount = 0, mylivecount_now = 0, delta_mylivecount;
+    sparse_load(s, grid_row(&data->grid, world, 0), data->grid.stride);
+    for (i = 0; i < rounds && total_live <= most; i++){
+        total_live = (int)sparse_step(s);
+    }
+    sparse_store(s, grid_row(&data->grid, world, 0), data->grid.stride);
+    sparse_free(s);
+    grid_fill_ghosts(&data->grid, world);
+    return i;
+}
 
-    for (i = data->row_start; i <= data->row_end; i++){
-        for (j = data->col_start; j <= data->col_end; j++){
-            if (data->world[j*data->rows+i] == 1){
-                mylivecount++;
+/* This function plays a game with -e auto: round by round on the pool's
+ * threads while the board is dense, and with the sparse engine whenever
+ * fewer than SPARSE_DENSITY of its cells are alive. The threads play
+ * AUTO_ROUNDS rounds at a time, and the density is checked in between;
+ * the sparse engine hands the board back once the density has grown to
+ * SPARSE_DENSITY_OUT, so a board near the line doesn't switch back and
+ * forth every few rounds.
+ *   param data: pointer to a struct gol_data with the board loaded
+ *   param targs: the threads' struct gol_data, partitioned
+ *   param pool: the worker pool, one worker per thread
+ */
+static void play_auto(struct gol_data *data, struct gol_data *targs,
+        struct pool *pool){
+    double cells = (double)data->rows*data->cols;
+    int played = 0, dense = 0, switches = 0, rounds, sparse;
+
+    while (played < data->iters){
+        rounds = data->iters - played;
+        if (total_live < SPARSE_DENSITY*cells){
+            sparse = play_sparse(data, targs[0].world, rounds,
+                    SPARSE_DENSITY_OUT);
+            played += sparse;
+            switches++;
+            //the sparse rounds changed the board behind the tiles' backs,
+            //so the threads have to look at every tile once more (the
+            //other board, world_copy, is out of date everywhere)
+            for (int t = 0; t < data->tiles_r*data->tiles_c; t++){
+                data->tile_stamp[t] = targs[0].round;
             }
+            continue;
+        }
+
+        rounds = (rounds > AUTO_ROUNDS) ? AUTO_ROUNDS : rounds;
+        stop_round = rounds;
+        for (int i = 0; i < data->threads; i++){
+            targs[i].iters = rounds;
+            //print the threads' partitions only the first time
+            targs[i].print = targs[i].print && played == 0;
+        }
+        pool_start(pool, play_gol, targs, sizeof(struct gol_data));
+        pool_wait(pool);
+        played += rounds;
+        dense += rounds;
     }
+    stop_round = data->iters;
+
+    if (data->print){
+        printf("auto: %d rounds dense, %d rounds sparse, %d switches to"\
+                " sparse\n", dense, data->iters - dense, switches);
     }
+}
 
-    //iterate through all of the cells in world array
-    for (i = data->row_start; i <= data->row_end; i++){
-        for (j = data->col_start; j <= data->col_end; j++){
-            
-            num_neighbors = check_neighbors(data, i, j);
-            //condition that makes the cell alive: checking world
+/* This function lists the tiles along one side of the board that hold
+ * cells first..last, where first may be below 0 and last past the end of
+ * the board: the board wraps around, so those are cells on the other
+ * side. The last tile along a side may be shorter than the rest.
+ * param int n: number of cells along this side of the board
+ * param int size: number of cells along this side of a tile
+ * param tiles: set to the tiles (at most TILE_SPAN of them for the
+ *              ranges tile_active asks about; a tile may be listed twice)
+ * returns the number of tiles listed
+ */
+static int tile_span(int first, int last, int n, int size, int *tiles){
+    int count = 0, m, end;
 
-            if ((num_neighbors == 3) || ((num_neighbors == 2) && \
-                (data->world[j*data->rows+i] == 1))){
-                
-                //updates live or dead in the world_copy
-                data->world_copy[j*data->rows+i] = 1;
-                
+    if (last - first + 1 >= n){
+        first = 0;
+        last = n - 1;
+    }
+    while (first <= last){
+        m = ((first % n) + n) % n;
+        tiles[count++] = m/size;
+        //jump to the first cell of the next tile
+        end = (m/size + 1)*size;
+        end = (end > n) ? n : end;
+        first += end - m;
+    }
+    return count;
+}
 
+/* This function checks if a tile has to be updated this round. A tile
+ * can only change if a tile within reach of it changed last round;
+ * otherwise the next round of the tile is the same as this one, and it
+ * is already sitting in world_copy too (world_copy holds the round
+ * before, and the tile didn't change since then), so it can be skipped.
+ * With one round per barrier the tiles within reach are the eight
+ * around it. With -t steps they are the tiles holding any cell up to
+ * steps cells away, and "changed" means changed over the last barrier or
+ * in the last round before it (see update_block), which is what it takes
+ * for the tile to stay put for the next steps rounds.
+ * param data: pointer to a struct gol_data
+ * param int tr, tc: the tile's row and column in the grid of tiles
+ * param int round: the round being computed
+ * returns 1 if the tile has to be updated, 0 if it can be skipped
+ */
+static int tile_active(struct gol_data *data, int tr, int tc, int round){
+    int rows[TILE_SPAN], cols[TILE_SPAN], nr, nc;
+    int r0 = tr*TILE_ROWS;
+    int c0 = tc*TILE_WORDS*64;
+    int r1 = r0 + TILE_ROWS - 1;
+    int c1 = c0 + TILE_WORDS*64 - 1;
+
+    //the grid of tiles wraps around like the board
+    r1 = (r1 > data->rows-1) ? data->rows-1 : r1;
+    c1 = (c1 > data->cols-1) ? data->cols-1 : c1;
+    nr = tile_span(r0 - data->steps, r1 + data->steps, data->rows,
+            TILE_ROWS, rows);
+    nc = tile_span(c0 - data->steps, c1 + data->steps, data->cols,
+            TILE_WORDS*64, cols);
+
+    for (int i = 0; i < nr; i++){
+        for (int j = 0; j < nc; j++){
+            if (__atomic_load_n(&data->tile_stamp[rows[i]*data->tiles_c +
+                        cols[j]], __ATOMIC_RELAXED) >= round-1){
+                return 1;
             }
-            else{
-                data->world_copy[j*data->rows+i] = 0;
-            }
         }
     }
+    return 0;
+}
+
+/* This function hashes one word of the board, at row r, word k. The
+ * board's hash is the XOR of all of its words' hashes, so a thread can
+ * update it for just the words it changed, and the threads' changes can
+ * be put together in any order. Empty words hash to 0, so the empty part
+ * of a board costs nothing.
+ * returns the hash */
+static inline uint64_t word_hash(struct gol_data *data, int r, int k,
+        uint64_t word){
+    uint64_t z;
+
+    if (word == 0){
+        return 0;
+    }
+    //splitmix64's mixer, on the word and its place on the board
+    z = word ^ (((uint64_t)r*data->grid.words + k + 1)*0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* This function hashes the whole board (see word_hash), for the start of
+ * a game; after that the threads keep the hash up to date as they go.
+ * param data: pointer to a struct gol_data with the board loaded
+ * returns the hash of world */
+uint64_t board_hash(struct gol_data *data){
+    uint64_t hash = 0;
+
+    for (int r = 0; r < data->rows; r++){
+        const uint64_t *row = grid_row(&data->grid, data->world, r);
+        for (int k = 0; k < data->grid.words; k++){
+            hash ^= word_hash(data, r, k, row[k]);
+        }
+    }
+    return hash;
+}
 
-    for (i = data->row_start; i <= data->row_end; i++){
-        for (j = data->col_start; j <= data->col_end; j++){
-            if (data->world_copy[j*data->rows+i] == 1){
-                mylivecount_now++;
+/* This function computes the next round of rows r0..r1, words k0..k1 of
+ * the board into world_copy, and fills in the ghost cells copied from
+ * them.
+ * param data: pointer to a struct gol_data
+ * param changed: any bits that changed are ORed into this
+ * param births: cells that come alive are added to this, unless it's NULL
+ * param hash: the change in board_hash is XORed into this, unless it's
+ *        NULL
+ * returns the change in the number of live cells
+ */
+static int update_rows(struct gol_data *data, int r0, int r1, int k0,
+        int k1, uint64_t *changed, int *births, uint64_t *hash){
+    const uint64_t *row;
+    uint64_t *out, diff = 0;
+    int delta;
+
+    //one call for all the rows, so each row's sums are worked out once
+    //(see kernel.c); rows r0-1 and r1+1 may be the ghost rows
+    delta = data->kernel->block(grid_row(&data->grid, data->world, r0),
+            grid_row(&data->grid, data->world_copy, r0), data->grid.stride,
+            r1-r0+1, k0, k1, data->grid.words, data->cols, &diff, births);
+    *changed |= diff;
+
+    for (int i = r0; i <= r1; i++){
+        grid_write_ghosts(&data->grid, data->world_copy, i, k0, k1);
+
+        //only words that changed move the hash, and most blocks of a
+        //settling board have none
+        if (hash && diff){
+            row = grid_row(&data->grid, data->world, i);
+            out = grid_row(&data->grid, data->world_copy, i);
+            for (int k = k0; k <= k1; k++){
+                if (out[k] != row[k]){
+                    *hash ^= word_hash(data, i, k, row[k]) ^
+                        word_hash(data, i, k, out[k]);
+                }
             }
         }
     }
+    return delta;
+}
 
-    delta_mylivecount = mylivecount_now - mylivecount;
-    
+/* This function returns the 64 cells of a packed row starting at column
+ * col, as one word (cell col in bit 0). The cells wrap around the end of
+ * the row, as many times as it takes on a row narrower than 64.
+ * param data: pointer to a struct gol_data
+ * param row: the row, from grid_row
+ * param int col: the first column, which may be off either end of the row
+ */
+static uint64_t window_word(struct gol_data *data, const uint64_t *row,
+        int col){
+    uint64_t out = 0, bits;
+    int got = 0, n, w, b;
+
+    col = ((col % data->cols) + data->cols) % data->cols;
+    while (got < 64){
+        //take cells up to the end of the row, then start over at 0
+        n = data->cols - col;
+        n = (n > 64 - got) ? 64 - got : n;
+        w = col/64;
+        b = col%64;
+        bits = row[w] >> b;
+        if (b != 0 && b + n > 64){
+            bits |= row[w+1] << (64 - b);
+        }
+        if (n < 64){
+            bits &= (1ULL << n) - 1;
+        }
+        out |= bits << got;
+        got += n;
+        col = 0;
+    }
+    return out;
+}
 
-    pthread_mutex_lock(&my_mutex);
-    total_live += delta_mylivecount;
-    pthread_mutex_unlock(&my_mutex);
+/* This function returns row y of one of a thread's tile buffers. Each
+ * buffer holds a tile and its halo, with a zero word on either side of
+ * every row for the kernel's east and west reads. */
+static uint64_t *block_row(uint64_t *buf, int y){
+    return buf + (size_t)y*(TILE_WORDS + 4) + 1;
+}
 
-    //swap pointers to both worlds after each round
-    temp = data->world;
-    data->world = data->world_copy;
-    data->world_copy = temp;
+/* This function plays steps rounds of rows r0..r1, words k0..k1 of the
+ * board at once, and writes the last one into world_copy along with its
+ * ghost cells. Cells up to steps away can reach the tile in that many
+ * rounds, so the tile is copied into the thread's own buffer with a halo
+ * of steps rows above and below and one word on each side, taken from
+ * the board with wrapping. The rounds are played on the buffer with the
+ * same row kernel, each one on a band a row narrower at the top and
+ * bottom, since the edge of the halo goes wrong by one more cell each
+ * round; halo cells are computed again by every tile around them. Only
+ * the tile is kept.
+ * param data: pointer to a struct gol_data
+ * param int steps: number of rounds to play, from 2 to data->steps
+ * param changed: set to nonzero if the tile is different from world or
+ *        changed in the last round
+ * returns the change in the number of live cells
+ */
+static int update_block(struct gol_data *data, int r0, int r1, int k0,
+        int k1, int steps, uint64_t *changed){
+    uint64_t *buf[2], *now, *before, *out, ignore = 0, next, mask;
+    const uint64_t *src, *old;
+    int width = k1 - k0 + 3;            // tile words plus the halo
+    int height = r1 - r0 + 1 + 2*steps; // tile rows plus the halo
+    int delta = 0, first, last, y, k;
+
+    buf[0] = data->block_buf;
+    buf[1] = data->block_buf + (size_t)(TILE_ROWS + 2*data->steps)*
+        (TILE_WORDS + 4);
+
+    //word 0 of a buffer row is the word before k0 on the board
+    for (y = 0; y < height; y++){
+        src = grid_row(&data->grid, data->world,
+                ((r0 - steps + y) % data->rows + data->rows) % data->rows);
+        now = block_row(buf[0], y);
+        for (k = 0; k < width; k++){
+            now[k] = window_word(data, src, (k0 - 1 + k)*64);
+        }
+        //an edge tile is narrower, so clear what a wider one left here
+        now[width] = 0;
+        block_row(buf[1], y)[width] = 0;
+    }
 
+    for (int s = 1; s <= steps; s++){
+        //the last round is only needed on the tile itself
+        first = (s == steps) ? 1 : 0;
+        last = (s == steps) ? width - 2 : width - 1;
+        for (y = s; y < height - s; y++){
+            data->kernel->row(block_row(buf[(s-1) & 1], y-1),
+                    block_row(buf[(s-1) & 1], y),
+                    block_row(buf[(s-1) & 1], y+1),
+                    block_row(buf[s & 1], y), first, last, width,
+                    width*64, &ignore, NULL);
+        }
+    }
+
+    for (int i = r0; i <= r1; i++){
+        now = block_row(buf[steps & 1], i - r0 + steps);
+        before = block_row(buf[(steps-1) & 1], i - r0 + steps);
+        old = grid_row(&data->grid, data->world, i);
+        out = grid_row(&data->grid, data->world_copy, i);
+        for (k = k0; k <= k1; k++){
+            //past the last column the buffer holds wrapped cells
+            mask = (k == data->grid.words-1) ?
+                ~0ULL >> (63 - ((data->cols-1) & 63)) : ~0ULL;
+            next = now[k - k0 + 1] & mask;
+            delta += __builtin_popcountll(next) - __builtin_popcountll(old[k]);
+            *changed |= (next ^ old[k]) | ((next ^ before[k - k0 + 1]) & mask);
+            out[k] = next;
+        }
+        grid_write_ghosts(&data->grid, data->world_copy, i, k0, k1);
+    }
+    return delta;
 }
 
+/* This function takes a tile off the tail of the calling thread's own
+ * queue.
+ * returns the tile, or -1 if the queue is empty */
+static int take_own_tile(struct tile_queue *q){
+    uint64_t ends = __atomic_load_n(&q->ends, __ATOMIC_ACQUIRE);
+    uint32_t head, tail;
+
+    do {
+        head = (uint32_t)ends;
+        tail = (uint32_t)(ends >> 32);
+        if (head >= tail){
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&q->ends, &ends,
+                ((uint64_t)(tail-1) << 32) | head, 0,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return q->tiles[tail-1];
+}
 
-/* This function iterates through all of the neighbors of the cell that
- * passed in, starting with the upper left neighbor, and circling all
- * 8 neighbors in clockwise fashion. it checks if each neighboring cell
- * is alive, and if it is alive, it adds one to the count of number of 
- * neighbors.
- * param data: pointer to a struct gol_data  initialized with
- *         all GOL game playing state
- * param int row: the value of current cell's row
- * param int col: the value of current cell's column
- * returns the number of neighbors the current cell has
- */
-int check_neighbors(struct gol_data *data, int row, int col){
-    //initiaize neighbor count to zero
-    int count = 0;
-    //start with the upper left neighbor
-    row--;
-    col--;
-    //these cell transformations take care of edge and corner cases, so 
-    //neighbors automatically change to cells that are on opposite sides of
-    //the game board
-    int r_trans = (row+data->rows) % data->rows;
-    int c_trans = (col+data->cols) % data->cols;
-
-    //if the upper left cell is alive, add 1 to count
-    if (data->world[c_trans*data->rows+r_trans]==1){
-        count++;
-    }
-    //iterate through remaining neighbors 1-7
-    for(int i=1; i<8; i++){
-        //look to the neighbor one to the right
-        if (i<3){
-            col++;
-            //do transformation for the new coordinatex to take care of edges
-            r_trans = (row+data->rows) % data->rows;
-            c_trans = (col+data->cols) % data->cols;
-
-            //add one to live neighbor count if neighbor is alive
-            if (data->world[c_trans*data->rows+r_trans]==1){
-            count++;
-            }
+/* This function steals a tile off the head of another thread's queue.
+ * returns the tile, or -1 if the queue is empty */
+static int steal_tile(struct tile_queue *q){
+    uint64_t ends = __atomic_load_n(&q->ends, __ATOMIC_ACQUIRE);
+    uint32_t head, tail;
+
+    do {
+        head = (uint32_t)ends;
+        tail = (uint32_t)(ends >> 32);
+        if (head >= tail){
+            return -1;
         }
-        if((i==3)||(i==4)){
-            //move down one row to check new neighbor
-            row++;
-            //do transformation for the new coordinatex to take care of edges
-            r_trans = (row+data->rows) % data->rows;
-            c_trans = (col+data->cols) % data->cols;
+    } while (!__atomic_compare_exchange_n(&q->ends, &ends,
+                ((uint64_t)tail << 32) | (head+1), 0,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return q->tiles[head];
+}
 
-            //add one to live neighbor count if neighbor is alive
-            if (data->world[c_trans*data->rows+r_trans]==1){
-            count++;
-            }
+/* This function picks the next tile for a thread to update this round:
+ * one of its own while it has any, then ones stolen from the other
+ * threads, starting with the next thread over.
+ * returns the tile, or -1 when every queue is empty */
+static int next_tile(struct gol_data *data){
+    int t = take_own_tile(&queues[data->id]);
+
+    for (int i = 1; t < 0 && i < data->threads; i++){
+        t = steal_tile(&queues[(data->id + i) % data->threads]);
+        if (t >= 0){
+            data->tiles_stolen++;
         }
-        if((i==5)||(i==6)){
-            //move left one row to check new neighbor
-            col--;
-            //do transformation for the new coordinatex to take care of edges
-            r_trans = (row+data->rows) % data->rows;
-            c_trans = (col+data->cols) % data->cols;
+    }
+    return t;
+}
 
-            //add one to live neighbor count if neighbor is alive
-            if (data->world[c_trans*data->rows+r_trans]==1){
-            count++;
-            }
+/* This function updates the cells, checking if they are alive or
+ * dead based on the number of neighbors the cell has. this function
+ * checks if the cells are alive in the world, but updates their
+ * live or dead status in the world_copy, as to not disrupt future 
+ * cells that still must be checked in world. (disrupt by prematurely
+ * changing life status)
+ * The board is bit-packed, and the row kernel picked at startup (see
+ * kernel.c) computes a whole row segment of words at a time. The ghost
+ * border takes care of wrapping around the board, so there is no modulo
+ * here; the new row's ghost cells are filled in as it is written.
+ * The kernel also counts the live cell change while it writes, so this is
+ * the only pass over the board each round.
+ * The board is updated tile by tile. Each thread starts the round with
+ * the tiles in its own part of the board and then steals tiles from
+ * threads that still have some left (see next_tile), so no thread sits
+ * at the barrier while another has a backlog. Tiles where nothing
+ * changed around them last round are skipped (see tile_active), so a
+ * mostly still board costs about as much as the part that moves.
+ * With -t, each tile plays several rounds before the barrier instead of
+ * one (see update_block), which cuts the number of barriers per run.
+ * param data: pointer to a struct gol_data  initialized with
+ *         all GOL game playing state
+ * param int steps: number of rounds to play before the barrier
+ *  no returns
+ */
+void update_cells(struct gol_data *data, int steps){
+    
+    uint64_t *temp;
+    uint64_t changed;
+    struct tile_queue *mine = &queues[data->id];
+    
+    int t, tr, tc, r0, r1, k0, k1;
+    int round = data->round + 1;
+
+    //change in live cell count, counted by the kernel as it goes
+    int delta_mylivecount = 0;
+    //cells born, only counted when they are written out (-S)
+    int births = 0;
+    //change in the board hash, only kept for -c
+    uint64_t hash = 0;
+
+    //refill this thread's queue; every thread is past the last round's
+    //barrier, so nobody is still taking last round's tiles
+    __atomic_store_n(&mine->ends, (uint64_t)mine->count << 32,
+            __ATOMIC_RELEASE);
+
+    while ((t = next_tile(data)) >= 0){
+        tr = t/data->tiles_c;
+        tc = t%data->tiles_c;
+        if (!tile_active(data, tr, tc, round)){
+            data->tiles_skipped++;
+            continue;
         }
-        if((i==7)){
-            //move up one row to check final neighbor
-            row--;
-            //do transformation for the new coordinatex to take care of edges
-            r_trans = (row+data->rows) % data->rows;
-            c_trans = (col+data->cols) % data->cols;
 
-            //add one to live neighbor count if neighbor is alive
-            if (data->world[c_trans*data->rows+r_trans]==1){
-            count++;
-            }
+        //the tiles on the bottom and right edges can be cut short
+        r0 = tr*TILE_ROWS;
+        r1 = r0 + TILE_ROWS - 1;
+        k0 = tc*TILE_WORDS;
+        k1 = k0 + TILE_WORDS - 1;
+        r1 = (r1 > data->rows-1) ? data->rows-1 : r1;
+        k1 = (k1 > data->grid.words-1) ? data->grid.words-1 : k1;
+
+        changed = 0;
+        if (steps == 1){
+            delta_mylivecount += update_rows(data, r0, r1, k0, k1,
+                    &changed, data->stats ? &births : NULL,
+                    data->max_period ? &hash : NULL);
+        } else {
+            delta_mylivecount += update_block(data, r0, r1, k0, k1, steps,
+                    &changed);
+        }
+        if (changed){
+            __atomic_store_n(&data->tile_stamp[t], round, __ATOMIC_RELAXED);
         }
+        data->tiles_done++;
+        TRACE_CELLS(data->id, (long)(r1 - r0 + 1)*steps*
+                (((k1 + 1)*64 > data->cols ? data->cols : (k1 + 1)*64) -
+                 k0*64));
     }
-    return count;
+
+    //thread 0 adds this up after the barrier (see reduce_live)
+    live_slots[(data->round & 1)*data->threads + data->id].delta =
+        delta_mylivecount;
+    live_slots[(data->round & 1)*data->threads + data->id].births = births;
+    live_slots[(data->round & 1)*data->threads + data->id].hash = hash;
+    data->round++;
+
+    //swap pointers to both worlds after each round
+    temp = data->world;
+    data->world = data->world_copy;
+    data->world_copy = temp;
+
 }
 
 
@@ -820,26 +2692,27 @@ int check_neighbors(struct gol_data *data, int row, int col){
  */
 void update_colors(struct gol_data *data) {
 
-    int i, j, r, c, index, buff_i;
+    int i, j, r, c, buff_i;
     color3 *buff;
+    const uint64_t *row;
 
     buff = data->image_buff;  // just for readability
     r = data->rows;
     c = data->cols;
 
     for (i = data->row_start; i <= data->row_end; i++) {
+        row = grid_row(&data->grid, data->world, i);
         for (j = data->col_start; j <= data->col_end; j++) {
 
-            index = i*c + j;
             // translate row index to y-coordinate value because in
             // the image buffer, (r,c)=(0,0) is the _lower_ left but
             // in the grid, (r,c)=(0,0) is _upper_ left.
             buff_i = (r - (i+1))*c + j;
 
             // update animation buffer
-            if (data->world[index] == 0) {
+            if (!grid_bit(row, j)) {
                 buff[buff_i] = colors[data->id%8];
-            } else if (data->world[index] == 1) {
+            } else {
                 buff[buff_i] = c3_black;
             }
         }
@@ -848,7 +2721,9 @@ void update_colors(struct gol_data *data) {
 /**************************************************************/
 /* Print the board to the terminal.
  *   data: gol game specific data
+ *   world: the board to print, data->world or a frame of it
  *   round: the current round number
+ *   live: live cells on that board
  * no return value
  *
  * NOTE: You may add extra printfs if you'd like, but please
@@ -856,18 +2731,23 @@ void update_colors(struct gol_data *data) {
  *       grading easier!
 
  */
-void print_board(struct gol_data *data, int round) {
+void print_board(struct gol_data *data, uint64_t *world, int round,
+        int live) {
 
-    int i, j;
+    int i, j, next;
+    const uint64_t *row;
 
     /* Print the round number. */
     fprintf(stderr, "Round: %d\n", round);
 
     for (i = 0; i < data->rows; ++i) {
+        row = grid_row(&data->grid, world, i);
+        next = grid_next_live(&data->grid, row, 0);
         for (j = 0; j < data->cols; ++j) {
             //if cell is alive
-            if (data->world[i*data->rows+j] == 1){
+            if (j == next){
                 fprintf(stderr, " @");
+                next = grid_next_live(&data->grid, row, j+1);
             }
             else{
                 //otherwise
@@ -880,7 +2760,39 @@ void print_board(struct gol_data *data, int round) {
 
 
     /* Print the total number of live cells. */
-    fprintf(stderr, "Live cells: %d\n\n", total_live);
+    fprintf(stderr, "Live cells: %d\n\n", live);
+}
+
+/* This function draws a frame in output mode 1, on the renderer's thread.
+ * param arg: the threads' struct gol_data array
+ * param frame: the board to draw
+ */
+static void draw_ascii(void *arg, const struct frame *frame) {
+    struct gol_data *data = (struct gol_data *)arg;
+
+    if (term) {
+        term_draw(term, frame->cells, frame->round, frame->live);
+    } else {
+        print_board(data, frame->cells, frame->round, frame->live);
+    }
+}
+
+/* This function draws a frame in output mode 2, on the renderer's thread:
+ * it colors each thread's part of the board the way that thread would
+ * have, then hands the image to ParaVisi.
+ * param arg: the threads' struct gol_data array
+ * param frame: the board to draw
+ */
+static void draw_visi(void *arg, const struct frame *frame) {
+    struct gol_data *targs = (struct gol_data *)arg;
+    struct gol_data view;
+
+    for (int t = 0; t < targs[0].threads; t++) {
+        view = targs[t];
+        view.world = frame->cells;
+        update_colors(&view);
+    }
+    draw_ready(targs[0].handle);
 }
 
 /**************************************************************/
@@ -0,0 +1,48 @@
+#ifndef __GOL_H__
+#define __GOL_H__
+
+/* This file declares what gol.c offers to programs other than gol itself:
+ * the record format of its statistics stream, and a way to play games
+ * from another program. Those programs build gol.c with GOL_NO_MAIN
+ * defined, which leaves out its main, and link it in (see the bench
+ * target in the makefile). */
+
+#include <stdint.h>
+
+/* One record of the statistics stream (-S bin), written after every
+ * round, and once before the first, in the machine's byte order. Each
+ * game in a run starts over at its first generation. */
+struct gol_stats {
+    int64_t generation;     // rounds played since the game began
+    int64_t population;     // live cells after the round
+    int64_t births;         // cells that came alive in the round
+    int64_t deaths;         // cells that died in the round
+};
+
+/* One timed game on a random board, for benchmarks */
+struct gol_bench {
+    int rows;           // board size and rounds to play
+    int cols;
+    int iters;
+    double density;     // chance that each cell starts out alive
+    unsigned long seed; // the same seed always gives the same board
+    int threads;
+    int divide_mode;    // 0 is col strips, 1 is row strips, 2 is 2D blocks
+    int steps;          // rounds per tile between barriers, as with -t
+    const char *kernel; // as with -k, NULL for auto
+    const char *rule;   // as with -R, NULL for B3/S23
+
+    // filled in by gol_bench_run
+    double secs;        // time taken to play the rounds
+    int live;           // live cells after the last round
+    const char *kernel_name;  // the kernel that was used
+};
+
+/* Plays the game bench describes with no output, on a pool of
+ * bench->threads threads, and fills in its results. Only the rounds are
+ * timed, not making the board or starting the threads. Prints an error
+ * and exits if the settings can't be played. In a TRACE=1 build, each
+ * game is traced on its own (see trace.h). */
+void gol_bench_run(struct gol_bench *bench);
+
+#endif  /* __GOL_H__ */
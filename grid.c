@@ -0,0 +1,150 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the board layout declared in grid.h. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "grid.h"
+
+/* This function fills in the layout of a board.
+ * param g: the layout to fill in
+ * param rows, cols: the size of the board
+ */
+void grid_init(struct grid *g, int rows, int cols){
+    g->rows = rows;
+    g->cols = cols;
+    g->words = (cols + 63)/64;
+    g->stride = g->words + 2;
+}
+
+/* This function returns the size of a board, ghost rows included.
+ * param g: the board's layout
+ * returns the size in bytes
+ */
+size_t grid_bytes(const struct grid *g){
+    return (size_t)(g->rows+2)*g->stride*sizeof(uint64_t);
+}
+
+/* This function allocates a board of all dead cells with mmap.
+ * param g: the board's layout
+ * returns the board
+ */
+uint64_t *grid_alloc(const struct grid *g){
+    void *cells = mmap(NULL, grid_bytes(g), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (cells == MAP_FAILED){
+        perror("mmap: board");
+        exit(1);
+    }
+    return cells;
+}
+
+/* This function frees a board from grid_alloc.
+ * param g: the layout the board was allocated for
+ * param cells: the board, or NULL
+ */
+void grid_free(const struct grid *g, uint64_t *cells){
+    if (cells){
+        munmap(cells, grid_bytes(g));
+    }
+}
+
+/* This function finds the next live cell of a row.
+ * param g: the board's layout
+ * param row: the row, from grid_row
+ * param c: the first column to look at
+ * returns the column of the live cell, or g->cols if there is none
+ */
+int grid_next_live(const struct grid *g, const uint64_t *row, int c){
+    int k = c/64;
+    uint64_t word;
+
+    if (c >= g->cols){
+        return g->cols;
+    }
+    //the bits past the last column are 0, so they are never found
+    word = row[k] & (~0ULL << (c%64));
+    while (word == 0){
+        if (++k == g->words){
+            return g->cols;
+        }
+        word = row[k];
+    }
+    return k*64 + __builtin_ctzll(word);
+}
+
+/* This function fills in the ghost cells that copy part of a row.
+ * param g: the board's layout
+ * param cells: the board
+ * param r: the row that was written
+ * param k0, k1: the words of the row that were written
+ */
+void grid_write_ghosts(const struct grid *g, uint64_t *cells, int r,
+        int k0, int k1){
+    uint64_t *row = grid_row(g, cells, r);
+    uint64_t *ghost;
+    int last = g->words-1;
+
+    if (k0 > k1){
+        return;
+    }
+    if (k0 == 0){
+        row[last+1] = row[0] & 1;
+    }
+    if (k1 == last){
+        row[-1] = (row[last] >> ((g->cols-1) & 63)) << 63;
+    }
+
+    //a board with one row is its own ghost row on both sides
+    for (int side = 0; side < 2; side++){
+        if (side == 0 && r == 0){
+            ghost = grid_row(g, cells, g->rows);
+        } else if (side == 1 && r == g->rows-1){
+            ghost = grid_row(g, cells, -1);
+        } else {
+            continue;
+        }
+        memcpy(ghost + k0, row + k0, sizeof(uint64_t)*(k1-k0+1));
+        if (k0 == 0){
+            ghost[last+1] = row[last+1];
+        }
+        if (k1 == last){
+            ghost[-1] = row[-1];
+        }
+    }
+}
+
+/* This function fills in every ghost cell of a board, for a board whose
+ * cells were written some other way than a row at a time (loading, or
+ * another engine).
+ * param g: the board's layout
+ * param cells: the board
+ */
+void grid_fill_ghosts(const struct grid *g, uint64_t *cells){
+    for (int r = 0; r < g->rows; r++){
+        grid_write_ghosts(g, cells, r, 0, g->words-1);
+    }
+}
+
+/* This function counts the live cells of a board.
+ * param g: the board's layout
+ * param cells: the board
+ * returns the number of live cells
+ */
+long grid_count(const struct grid *g, uint64_t *cells){
+    long live = 0;
+
+    for (int r = 0; r < g->rows; r++){
+        const uint64_t *row = grid_row(g, cells, r);
+        for (int k = 0; k < g->words; k++){
+            live += __builtin_popcountll(row[k]);
+        }
+    }
+    return live;
+}
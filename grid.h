@@ -0,0 +1,88 @@
+#ifndef __GRID_H__
+#define __GRID_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* This file declares the one layout every board in the program is kept
+ * in, and the functions that get at it. Loading, the rounds, the
+ * animation and printing all go through these, so the layout is only
+ * spelled out here.
+ *
+ * A board is row-major and bit-packed: each row is words 64-bit words,
+ * and cell (r, c) is bit c%64 of word c/64 of row r. Bits past the last
+ * column are always 0. Around the cells is a ghost border one cell wide,
+ * copied from the opposite edge so a round never has to wrap indices
+ * around the board:
+ *   - row -1 is a copy of the last row, and row rows a copy of row 0
+ *   - word -1 of each row holds the row's last column in bit 63
+ *   - word words of each row holds the row's column 0 in bit 0
+ * Rows are stride words apart, ghost words included, and the whole
+ * board, ghost rows included, is one block of (rows+2)*stride words that
+ * starts on a page boundary; that block is what snapshots save (see
+ * snapshot.h). */
+
+struct grid {
+    int rows;
+    int cols;
+    int words;      // 64-bit words of cells in a row
+    size_t stride;  // words from one row to the next (words+2)
+};
+
+/* Fills in the layout of a board of rows x cols. */
+void grid_init(struct grid *g, int rows, int cols);
+
+/* returns the size of a board in bytes, ghost rows included */
+size_t grid_bytes(const struct grid *g);
+
+/* Allocates a board of all dead cells. The memory comes straight from
+ * mmap, so none of its pages exist until something first writes to
+ * them, and then they are put on the NUMA node of the thread that did. */
+uint64_t *grid_alloc(const struct grid *g);
+
+/* Frees a board from grid_alloc (NULL is fine). */
+void grid_free(const struct grid *g, uint64_t *cells);
+
+/* returns word 0 of row r, for r from -1 to rows */
+static inline uint64_t *grid_row(const struct grid *g, uint64_t *cells,
+        int r){
+    return cells + (size_t)(r+1)*g->stride + 1;
+}
+
+/* returns 1 if cell c of a row (from grid_row) is alive, 0 if not */
+static inline int grid_bit(const uint64_t *row, int c){
+    return (row[c/64] >> (c%64)) & 1;
+}
+
+/* Brings cell c of a row to life. */
+static inline void grid_set_bit(uint64_t *row, int c){
+    row[c/64] |= 1ULL << (c%64);
+}
+
+/* returns 1 if cell (r, c) of a board is alive, 0 if not */
+static inline int grid_cell(const struct grid *g, uint64_t *cells, int r,
+        int c){
+    return grid_bit(grid_row(g, cells, r), c);
+}
+
+/* returns the first live cell of a row at or after column c, or cols if
+ * there is none, skipping dead cells a word at a time:
+ *   for (c = grid_next_live(g, row, 0); c < g->cols;
+ *           c = grid_next_live(g, row, c+1)) */
+int grid_next_live(const struct grid *g, const uint64_t *row, int c);
+
+/* Fills in the ghost cells that copy words k0..k1 of row r, right after
+ * they were written. Every ghost word is filled by whoever writes the
+ * word it copies: whoever has word 0 fills the east ghost word, whoever
+ * has the last word fills the west one, and whoever has row 0 or the
+ * last row copies its part into the ghost row on the other side. */
+void grid_write_ghosts(const struct grid *g, uint64_t *cells, int r,
+        int k0, int k1);
+
+/* Fills in all of the ghost cells of a board. */
+void grid_fill_ghosts(const struct grid *g, uint64_t *cells);
+
+/* returns the number of live cells on a board */
+long grid_count(const struct grid *g, uint64_t *cells);
+
+#endif  /* __GRID_H__ */
@@ -0,0 +1,475 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the HashLife engine (Gosper's algorithm).
+ *
+ * A square of 2^k x 2^k cells is a node of level k with four children of
+ * level k-1 (level 0 nodes are single cells). Nodes are hash-consed: there
+ * is only ever one node with a given four children, so equal squares
+ * anywhere on the board, at any time, are the same node. For a node of
+ * level k, result(node, j) is its center 2^(k-1) x 2^(k-1) square 2^j
+ * rounds later (j <= k-2), and it is computed once and remembered in the
+ * node. Computing it from nine overlapping subsquares and then four more
+ * results advances 2^(k-2) rounds with only 13 recursive calls, most of
+ * which hit the memo on boards with any repetition in space or time.
+ *
+ * The game board wraps around at its edges, and HashLife works on the
+ * infinite plane, so the board is laid out as a repeating tiling of the
+ * plane. To jump 2^j rounds we build a window of that tiling big enough
+ * that its center covers the whole board (and is at least 2^j cells from
+ * the window's edges), take the window's result, and read the board back
+ * out of its center. Squares of the window that sit at the same offset in
+ * the tiling are the same square, so building the window is memoized on
+ * that offset, which keeps it cheap even when the window is huge.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "hashlife.h"
+
+/* Nodes are allocated in chunks of this many */
+#define CHUNK_NODES   (1 << 16)
+
+/* Once this many nodes exist, everything is thrown away before the next
+ * jump and rebuilt from the board (~256MB of nodes) */
+#define MAX_NODES     (1 << 22)
+
+/* Most distinct squares of one level the window building memo will keep */
+#define MAX_MEMO      (1 << 22)
+
+/* Deepest node level that can be built */
+#define MAX_LEVEL     (62)
+
+struct node {
+    struct node *nw, *ne, *sw, *se; // children (NULL for level 0)
+    struct node *next;      // next node in the same hash bucket
+    struct node *res_full;  // result(this, level-2), once computed
+    struct node *res_part;  // result(this, res_j) for a smaller step
+    int level;
+    int res_j;
+};
+
+struct chunk {
+    struct chunk *next;
+    struct node nodes[CHUNK_NODES];
+};
+
+/* an entry of the window building memo, keyed on level and offset */
+struct build_entry {
+    struct node *node;      // NULL if the entry is empty
+    int level;
+    int oy, ox;
+};
+
+static struct node **table;     // hash table of all nodes of level >= 1
+static size_t buckets;          // size of table (a power of 2)
+static size_t count;            // number of nodes in table
+static struct chunk *chunks;    // chunks nodes are allocated from
+static int chunk_used;          // nodes used in the first chunk
+static struct node leaves[2];   // the dead and the live cell
+static struct node *empty[MAX_LEVEL+1]; // all-dead node of each level
+
+static struct build_entry *memo;  // window building memo
+static size_t memo_size;          // size of memo (a power of 2)
+static size_t memo_count;         // entries used in memo
+static char memo_level[MAX_LEVEL+1]; // levels the memo is used for
+
+/* the board being played */
+static uint64_t *hl_board;
+static size_t hl_stride;
+static int hl_rows, hl_cols;
+static struct rule hl_rule;
+
+static struct build_entry *memo_slot(int level, int oy, int ox);
+
+/* This function allocates a new node, exiting if out of memory. */
+static struct node *new_node(void){
+    if (chunks == NULL || chunk_used == CHUNK_NODES){
+        struct chunk *c = malloc(sizeof(struct chunk));
+        if (!c){ perror("malloc: hashlife nodes"); exit(1); }
+        c->next = chunks;
+        chunks = c;
+        chunk_used = 0;
+    }
+    return &chunks->nodes[chunk_used++];
+}
+
+/* This function hashes the four children of a node. */
+static inline size_t hash4(struct node *nw, struct node *ne,
+        struct node *sw, struct node *se){
+    uint64_t h = (uintptr_t)nw;
+    h = h*0x9e3779b97f4a7c15ULL + (uintptr_t)ne;
+    h = h*0x9e3779b97f4a7c15ULL + (uintptr_t)sw;
+    h = h*0x9e3779b97f4a7c15ULL + (uintptr_t)se;
+    return (size_t)(h ^ (h >> 29));
+}
+
+/* This function doubles the hash table and moves every node over. */
+static void grow_table(void){
+    size_t new_buckets = buckets ? buckets*2 : (1 << 16);
+    struct node **new_table = calloc(new_buckets, sizeof(struct node *));
+    if (!new_table){ perror("calloc: hashlife table"); exit(1); }
+
+    for (size_t i = 0; i < buckets; i++){
+        struct node *n = table[i];
+        while (n){
+            struct node *next = n->next;
+            size_t h = hash4(n->nw, n->ne, n->sw, n->se) & (new_buckets-1);
+            n->next = new_table[h];
+            new_table[h] = n;
+            n = next;
+        }
+    }
+    free(table);
+    table = new_table;
+    buckets = new_buckets;
+}
+
+/* This function returns the one node with these four children, making it
+ * if it doesn't exist yet. */
+static struct node *find(struct node *nw, struct node *ne,
+        struct node *sw, struct node *se){
+    size_t h = hash4(nw, ne, sw, se) & (buckets-1);
+    struct node *n;
+
+    for (n = table[h]; n; n = n->next){
+        if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se){
+            return n;
+        }
+    }
+
+    n = new_node();
+    n->nw = nw;
+    n->ne = ne;
+    n->sw = sw;
+    n->se = se;
+    n->level = nw->level + 1;
+    n->res_full = NULL;
+    n->res_part = NULL;
+    n->res_j = -1;
+    n->next = table[h];
+    table[h] = n;
+    count++;
+    if (count > buckets){
+        grow_table();
+    }
+    return n;
+}
+
+/* This function frees every node. */
+static void free_nodes(void){
+    while (chunks){
+        struct chunk *next = chunks->next;
+        free(chunks);
+        chunks = next;
+    }
+    free(table);
+    table = NULL;
+    buckets = 0;
+    count = 0;
+}
+
+/* This function throws away every node and sets up an empty tree. */
+static void reset_nodes(void){
+    free_nodes();
+    grow_table();
+
+    leaves[0].level = 0;
+    leaves[1].level = 0;
+    empty[0] = &leaves[0];
+    for (int k = 1; k <= MAX_LEVEL; k++){
+        empty[k] = find(empty[k-1], empty[k-1], empty[k-1], empty[k-1]);
+    }
+}
+
+/* This function computes the center 2x2 of a level 2 node one round
+ * later, straight from the rule. */
+static struct node *base_result(struct node *n){
+    int cell[4][4], next[4];
+    struct node *q[4] = { n->nw, n->ne, n->sw, n->se };
+
+    //unpack the 4x4 cells, quadrant by quadrant
+    for (int i = 0; i < 4; i++){
+        int y = (i/2)*2, x = (i%2)*2;
+        cell[y][x] = (q[i]->nw == &leaves[1]);
+        cell[y][x+1] = (q[i]->ne == &leaves[1]);
+        cell[y+1][x] = (q[i]->sw == &leaves[1]);
+        cell[y+1][x+1] = (q[i]->se == &leaves[1]);
+    }
+
+    for (int i = 0; i < 4; i++){
+        int y = 1 + i/2, x = 1 + i%2, neighbors = 0;
+        for (int dy = -1; dy <= 1; dy++){
+            for (int dx = -1; dx <= 1; dx++){
+                if (dy || dx){
+                    neighbors += cell[y+dy][x+dx];
+                }
+            }
+        }
+        next[i] = cell[y][x] ? (hl_rule.survive >> neighbors) & 1 :
+            (hl_rule.birth >> neighbors) & 1;
+    }
+    return find(&leaves[next[0]], &leaves[next[1]], &leaves[next[2]],
+            &leaves[next[3]]);
+}
+
+/* This function returns the center half of a node, with no time passing */
+static struct node *center(struct node *n){
+    return find(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+/* This function returns the center half of a node of level k, 2^j rounds
+ * later, for 0 <= j <= k-2. */
+static struct node *result(struct node *n, int j){
+    struct node *sub[9], *r;
+    int k = n->level;
+    int step;
+
+    if (n == empty[k]){
+        return empty[k-1];
+    }
+    if (j == k-2 && n->res_full){
+        return n->res_full;
+    }
+    if (j != k-2 && n->res_part && n->res_j == j){
+        return n->res_part;
+    }
+
+    if (k == 2){
+        r = base_result(n);
+    } else {
+        //nine overlapping squares of level k-1, three by three
+        sub[0] = n->nw;
+        sub[1] = find(n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw);
+        sub[2] = n->ne;
+        sub[3] = find(n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne);
+        sub[4] = find(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+        sub[5] = find(n->ne->sw, n->ne->se, n->se->nw, n->se->ne);
+        sub[6] = n->sw;
+        sub[7] = find(n->sw->ne, n->se->nw, n->sw->se, n->se->sw);
+        sub[8] = n->se;
+
+        //a full step runs both halves of the time, a smaller step only
+        //the second
+        for (int i = 0; i < 9; i++){
+            sub[i] = (j == k-2) ? result(sub[i], k-3) : center(sub[i]);
+        }
+        step = (j == k-2) ? k-3 : j;
+
+        r = find(
+            result(find(sub[0], sub[1], sub[3], sub[4]), step),
+            result(find(sub[1], sub[2], sub[4], sub[5]), step),
+            result(find(sub[3], sub[4], sub[6], sub[7]), step),
+            result(find(sub[4], sub[5], sub[7], sub[8]), step));
+    }
+
+    if (j == k-2){
+        n->res_full = r;
+    } else {
+        n->res_part = r;
+        n->res_j = j;
+    }
+    return r;
+}
+
+/* This function makes the window building memo empty, or twice as big
+ * with all of its entries kept when grow is set. */
+static void resize_memo(int grow){
+    struct build_entry *old = memo;
+    size_t old_size = memo_size;
+
+    memo_size = grow ? old_size*2 : 1024;
+    memo = calloc(memo_size, sizeof(struct build_entry));
+    if (!memo){ perror("calloc: hashlife memo"); exit(1); }
+    memo_count = 0;
+
+    for (size_t i = 0; grow && i < old_size; i++){
+        if (old[i].node){
+            *memo_slot(old[i].level, old[i].oy, old[i].ox) = old[i];
+            memo_count++;
+        }
+    }
+    free(old);
+}
+
+/* This function returns the memo entry for a square of the window, which
+ * is either the one holding it or the empty one it should go in. */
+static struct build_entry *memo_slot(int level, int oy, int ox){
+    uint64_t h = ((uint64_t)level*0x9e3779b97f4a7c15ULL) ^
+        ((uint64_t)oy*0xc2b2ae3d27d4eb4fULL) ^
+        ((uint64_t)ox*0x165667b19e3779f9ULL);
+    size_t i = (size_t)(h ^ (h >> 31)) & (memo_size-1);
+
+    while (memo[i].node &&
+            (memo[i].level != level || memo[i].oy != oy ||
+             memo[i].ox != ox)){
+        i = (i+1) & (memo_size-1);
+    }
+    return &memo[i];
+}
+
+/* This function builds the node for a 2^level square of the tiling, given
+ * the board cell (oy, ox) its top left corner falls on. */
+static struct node *build(int level, int oy, int ox){
+    struct build_entry *e;
+    struct node *n;
+    int dy, dx;
+
+    if (level == 0){
+        return &leaves[(hl_board[(size_t)oy*hl_stride + ox/64] >> (ox%64))
+            & 1];
+    }
+
+    //the same offset in the tiling is the same square
+    if (memo_level[level]){
+        e = memo_slot(level, oy, ox);
+        if (e->node){
+            return e->node;
+        }
+    }
+
+    //where the other three quarters start on the board
+    dy = (int)((1UL << (level-1)) % hl_rows);
+    dx = (int)((1UL << (level-1)) % hl_cols);
+    dy = (oy + dy) % hl_rows;
+    dx = (ox + dx) % hl_cols;
+    n = find(build(level-1, oy, ox), build(level-1, oy, dx),
+            build(level-1, dy, ox), build(level-1, dy, dx));
+    if (!memo_level[level]){
+        return n;
+    }
+
+    //look the slot up again, building the quarters added entries
+    if (2*(memo_count+1) > memo_size){
+        resize_memo(1);
+    }
+    e = memo_slot(level, oy, ox);
+    e->node = n;
+    e->level = level;
+    e->oy = oy;
+    e->ox = ox;
+    memo_count++;
+    return n;
+}
+
+/* This function writes the cells of a node back onto the board, for the
+ * part of it that lands on the board, and counts the live ones.
+ * returns the number of live cells written */
+static long extract(struct node *n, long y, long x){
+    long half, live = 0;
+
+    if (y >= hl_rows || x >= hl_cols || n == empty[n->level]){
+        return 0;
+    }
+    if (n->level == 0){
+        hl_board[(size_t)y*hl_stride + x/64] |= 1ULL << (x%64);
+        return 1;
+    }
+    half = 1L << (n->level-1);
+    live += extract(n->nw, y, x);
+    live += extract(n->ne, y, x+half);
+    live += extract(n->sw, y+half, x);
+    live += extract(n->se, y+half, x+half);
+    return live;
+}
+
+/* This function returns the greatest common divisor of a and b. */
+static unsigned long gcd(unsigned long a, unsigned long b){
+    while (b){
+        unsigned long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* This function jumps the board ahead 2^j rounds.
+ * returns the number of live cells afterwards */
+static long jump(int j){
+    int big = (hl_rows > hl_cols) ? hl_rows : hl_cols;
+    int level = 3;
+    int oy, ox;
+    unsigned long quarter;
+    struct node *res;
+
+    //the center half has to cover the board, and the window has to reach
+    //2^j past it on every side
+    while ((1UL << (level-1)) < (unsigned long)big || level-2 < j){
+        level++;
+    }
+    if (level > MAX_LEVEL){
+        printf("Error: hashlife board is too big\n");
+        exit(1);
+    }
+
+    //the window's top left is a quarter window up and left of board
+    //cell (0, 0), so the center half starts right on it
+    quarter = 1UL << (level-2);
+    oy = (int)((hl_rows - quarter % hl_rows) % hl_rows);
+    ox = (int)((hl_cols - quarter % hl_cols) % hl_cols);
+
+    //memoize the levels where the window has more squares than there are
+    //offsets for them to start at, so squares repeat
+    for (int l = 1; l <= level; l++){
+        unsigned long side = 1UL << l;
+        unsigned long offsets = (unsigned long)(hl_rows/gcd(side, hl_rows))
+            * (hl_cols/gcd(side, hl_cols));
+        unsigned long across = 1UL << (level - l);
+        memo_level[l] = offsets <= MAX_MEMO &&
+            (across >= (1UL << 31) || across*across > offsets);
+    }
+
+    resize_memo(0);
+    res = result(build(level, oy, ox), j);
+
+    for (int r = 0; r < hl_rows; r++){
+        memset(hl_board + (size_t)r*hl_stride, 0,
+                sizeof(uint64_t)*((hl_cols + 63)/64));
+    }
+    return extract(res, 0, 0);
+}
+
+/* This function plays gens rounds on the board, one jump per set bit of
+ * gens, smallest first (so the big jumps start from a board that has had
+ * time to settle down).
+ * returns the number of live cells after the last round */
+long hashlife_run(uint64_t *board, int rows, int cols, size_t stride,
+        long gens, struct rule rule){
+    long live = 0;
+
+    hl_board = board;
+    hl_rule = rule;
+    hl_stride = stride;
+    hl_rows = rows;
+    hl_cols = cols;
+    reset_nodes();
+
+    for (int j = 0; j <= 62; j++){
+        if (!(gens & (1L << j))){
+            continue;
+        }
+        //the board was written back, so old nodes are only a cache
+        if (count > MAX_NODES){
+            reset_nodes();
+        }
+        live = jump(j);
+    }
+
+    if (gens == 0){
+        for (int r = 0; r < rows; r++){
+            for (int k = 0; k < (cols + 63)/64; k++){
+                live += __builtin_popcountll(board[(size_t)r*stride + k]);
+            }
+        }
+    }
+
+    free(memo);
+    memo = NULL;
+    memo_size = 0;
+    free_nodes();
+    return live;
+}
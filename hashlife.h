@@ -0,0 +1,23 @@
+#ifndef __HASHLIFE_H__
+#define __HASHLIFE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "kernel.h"
+
+/* This file declares the HashLife engine, an alternative to the round by
+ * round update for very long runs. It keeps the board as a hash-consed
+ * quadtree and memoizes the future of every square it has seen, so it
+ * can jump many rounds ahead at once. */
+
+/* Plays gens rounds of the game under rule on a rows x cols board that
+ * wraps around at the edges, in place.
+ *   board: row r starts at board + r*stride; cell c of a row is bit c%64
+ *          of word c/64, and bits past the last column are 0
+ *   stride: words from the start of one row to the start of the next
+ * Only the words holding cells are written.
+ * returns the number of live cells after the last round */
+long hashlife_run(uint64_t *board, int rows, int cols, size_t stride,
+        long gens, struct rule rule);
+
+#endif  /* __HASHLIFE_H__ */
@@ -0,0 +1,830 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the kernels that compute the next round of the
+ * bit-packed board. Each row is stored in 64-bit words, with cell c in
+ * bit c%64 of word c/64. A cell's eight neighbors are lined up with it by
+ * shifting the rows above, below and the row itself one bit east and
+ * west, and the neighbor counts are then added with bit-sliced adders so
+ * that every bit position is an independent cell.
+ *
+ * Rows carry a one-cell ghost border (see kernel.h), so wrapping around
+ * the board needs no modulo and no edge cases, apart from the last word
+ * of a row whose width isn't a multiple of 64.
+ *
+ * The scalar kernel handles one word (64 cells) at a time. The AVX2 and
+ * AVX-512 kernels run the same adder network on 4 or 8 words at a time.
+ * They are compiled with target attributes, so the rest of the program
+ * does not need -mavx2, and kernel_select only hands them out when CPUID
+ * says the CPU supports them.
+ *
+ * The rule is applied to the neighbor count planes at the end of the
+ * adder network. Each kernel is written once, as an always-inline body
+ * that takes the rule's birth and survive masks, and is then stamped out
+ * for every rule in RULES with the masks as constants, so the compiler
+ * folds the rule into a handful of logic instructions, the same as the
+ * hand-made network for Conway's rule. One more copy of each takes the
+ * masks from any_birth and any_survive, for rules not in RULES.
+ *
+ * The block kernels compute many rows at once (see block_kernel_fn).
+ * Going row by row, every row's east + self + west sums are worked out
+ * three times: once as the row above, once as the row itself and once
+ * as the row below. The block kernels work them out once per row instead,
+ * into a rolling window of three rows of sums, and make each output row
+ * from the window. The window is only STRIP_WORDS words wide, so it
+ * stays in L1 however wide the board is; bigger blocks are done a part
+ * at a time.
+ */
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+/* The rules that get kernels of their own:
+ *   X(tag, name, B/S notation, birth mask, survive mask) */
+#define RULES(X) \
+    X(conway,     "conway",     "B3/S23",        0x008, 0x00c) \
+    X(highlife,   "highlife",   "B36/S23",       0x048, 0x00c) \
+    X(daynight,   "daynight",   "B3678/S34678",  0x1c8, 0x1d8) \
+    X(seeds,      "seeds",      "B2/S",          0x004, 0x000) \
+    X(replicator, "replicator", "B1357/S1357",   0x0aa, 0x0aa) \
+    X(maze,       "maze",       "B3/S12345",     0x008, 0x03e) \
+    X(twobytwo,   "2x2",        "B36/S125",      0x048, 0x026) \
+    X(morley,     "morley",     "B368/S245",     0x148, 0x034) \
+    X(lwod,       "lwod",       "B3/S012345678", 0x008, 0x1ff)
+
+#define RULE_INDEX(tag, name, text, birth, survive)  RULE_##tag,
+enum { RULES(RULE_INDEX) NUM_RULES };
+
+#define RULE_ENTRY(tag, name, text, birth, survive) \
+    { name, text, birth, survive },
+static const struct rule_entry {
+    const char *name;
+    const char *text;
+    uint16_t birth;
+    uint16_t survive;
+} rules[NUM_RULES] = { RULES(RULE_ENTRY) };
+
+/* The rule the kernels built for any rule play (set by kernel_select) */
+static uint16_t any_birth, any_survive;
+
+#define IS_CONWAY(birth, survive)  ((birth) == 0x008 && (survive) == 0x00c)
+
+/* Size of the parts the block kernels split a block into: three rows of
+ * sums for STRIP_WORDS words take 6KB, and STRIP_ROWS keeps a part to a
+ * few pages of the board, since going down a tall narrow strip of a wide
+ * board touches a new page every row */
+#define STRIP_ROWS   (16)
+#define STRIP_WORDS  (128)
+
+/* Words of 4 and 8 lanes for the block kernels, which are written with
+ * GCC's vector operators rather than intrinsics so that one body serves
+ * every width */
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+typedef uint64_t u64x8 __attribute__((vector_size(64)));
+
+/* The parameters and arguments every block kernel takes */
+#define BLOCK_PARAMS  const uint64_t *in, uint64_t *out, size_t stride, \
+        int n, int k0, int k1, int words, int cols, uint64_t *changed, \
+        int *births
+#define BLOCK_ARGS    in, out, stride, n, k0, k1, words, cols, changed, \
+        births
+
+/* The parameters and arguments every row kernel takes */
+#define ROW_PARAMS  const uint64_t *above, const uint64_t *row, \
+        const uint64_t *below, uint64_t *out, int k0, int k1, \
+        int words, int cols, uint64_t *changed, int *births
+#define ROW_ARGS    above, row, below, out, k0, k1, words, cols, \
+        changed, births
+
+/* This macro defines a function that applies a rule to the neighbor
+ * counts of a vector of cells, for a vector type (the bit operators work
+ * on GCC's vector types as they do on integers). The counts come as the
+ * ones bit of each count and the four bits it carried into the twos,
+ * which are added up here into the twos, fours and eights bits.
+ *
+ * The next state of a cell with n neighbors is one of: dead, alive, the
+ * cell itself, or the cell flipped (rule_cell). The ones bit picks
+ * between counts 2k and 2k+1, then the twos and the fours pick k, as a
+ * tree of selects. Counts 0 and 8 share their low bits, so the eights
+ * only come into it when the rule treats them differently. When the rule
+ * is a constant, every select with a constant side folds away, and what
+ * is left is about as short as the network for Conway's rule.
+ *   returns the cells alive next round */
+#define DEFINE_APPLY_RULE(fn, type, attrs) \
+attrs static inline type fn##_cell(type cell, unsigned birth, \
+        unsigned survive, int n){ \
+    type zero = cell ^ cell; \
+\
+    if ((birth >> n) & (survive >> n) & 1){ \
+        return ~zero; \
+    } else if ((birth >> n) & 1){ \
+        return ~cell; \
+    } else if ((survive >> n) & 1){ \
+        return cell; \
+    } \
+    return zero; \
+} \
+\
+attrs static inline type fn##_select(type s, type a, type b){ \
+    return (s & a) | (~s & b); \
+} \
+\
+attrs static inline type fn(type ones, type c0, type c1, type c2, type t, \
+        type cell, unsigned birth, unsigned survive){ \
+    type p = c0 ^ c1, q = c0 & c1, r = c2 ^ t, u = c2 & t; \
+    type twos = p ^ r; \
+    type fours = q ^ u ^ (p & r); \
+    type out; \
+\
+    /* written out, not looped, so that it folds at -O2 */ \
+    type n01 = fn##_select(ones, fn##_cell(cell, birth, survive, 1), \
+            fn##_cell(cell, birth, survive, 0)); \
+    type n23 = fn##_select(ones, fn##_cell(cell, birth, survive, 3), \
+            fn##_cell(cell, birth, survive, 2)); \
+    type n45 = fn##_select(ones, fn##_cell(cell, birth, survive, 5), \
+            fn##_cell(cell, birth, survive, 4)); \
+    type n67 = fn##_select(ones, fn##_cell(cell, birth, survive, 7), \
+            fn##_cell(cell, birth, survive, 6)); \
+\
+    out = fn##_select(fours, fn##_select(twos, n67, n45), \
+            fn##_select(twos, n23, n01)); \
+    if (((birth ^ (birth >> 8)) | (survive ^ (survive >> 8))) & 1){ \
+        out = fn##_select(q & u, fn##_cell(cell, birth, survive, 8), out); \
+    } \
+    return out; \
+}
+
+DEFINE_APPLY_RULE(apply_rule, uint64_t, __attribute__((always_inline)))
+
+/* This function adds three bit planes together, one independent 1-bit
+ * adder per bit position.
+ * param a, b, c: the bit planes to add
+ * param carry: set to the twos bit of each sum
+ * returns the ones bit of each sum
+ */
+static inline uint64_t add3(uint64_t a, uint64_t b, uint64_t c,
+        uint64_t *carry){
+    uint64_t t = a ^ b;
+    *carry = (a & b) | (t & c);
+    return t ^ c;
+}
+
+/* This function computes the next state of the 64 cells packed in one
+ * word, given the word itself and its eight neighbor planes (each plane
+ * is the board shifted so that a cell's neighbor lines up with the cell).
+ * The neighbor counts are added with bit-sliced adders, so all 64 cells
+ * are handled at once. Under Conway's rule a cell is alive next round if
+ * it has exactly 3 live neighbors, or exactly 2 and is alive now, which
+ * takes just a few more instructions; other rules go through apply_rule.
+ * returns the word of next round cells
+ */
+__attribute__((always_inline))
+static inline uint64_t next_word(uint64_t nw, uint64_t n, uint64_t ne,
+        uint64_t w, uint64_t c, uint64_t e,
+        uint64_t sw, uint64_t s, uint64_t se,
+        unsigned birth, unsigned survive){
+    uint64_t c0, c2, t;
+    //ones and twos of the row above, the row below, and the two sides
+    uint64_t s0 = add3(nw, n, ne, &c0);
+    uint64_t s2 = add3(sw, s, se, &c2);
+    uint64_t s1 = w ^ e;
+    uint64_t c1 = w & e;
+    //ones bit of the total count, t carries into the twos
+    uint64_t ones = add3(s0, s1, s2, &t);
+
+    if (IS_CONWAY(birth, survive)){
+        //the count is 2 or 3 when exactly one of the twos is set
+        uint64_t one_two = (c0 ^ c1 ^ c2 ^ t) & ~((c0 & c1) | (c2 & t));
+
+        return one_two & (ones | c);
+    }
+    return apply_rule(ones, c0, c1, c2, t, c, birth, survive);
+}
+
+/* This function returns word k of a packed row shifted so that each cell
+ * lines up with its west (left) neighbor. For k == 0 the carry comes from
+ * the ghost word row[-1], which holds the last column of the row. */
+static inline uint64_t west_of(const uint64_t *row, int k){
+    return (row[k] << 1) | (row[k-1] >> 63);
+}
+
+/* This function returns word k of a packed row shifted so that each cell
+ * lines up with its east (right) neighbor. For the last word of a row
+ * whose width is a multiple of 64, row[k+1] is the ghost word that holds
+ * column 0. */
+static inline uint64_t east_of(const uint64_t *row, int k){
+    return (row[k] >> 1) | (row[k+1] << 63);
+}
+
+/* This function is east_of for a last word that is only partly used: the
+ * last column sits below bit 63, so column 0 from the ghost word is
+ * shifted in right after it. */
+static inline uint64_t east_of_last(const uint64_t *row, int words,
+        int cols){
+    return (row[words-1] >> 1) | ((row[words] & 1) << ((cols-1) & 63));
+}
+
+/* This function computes word k of the next round with the scalar
+ * adder network. */
+__attribute__((always_inline))
+static inline uint64_t scalar_word(const uint64_t *above,
+        const uint64_t *row, const uint64_t *below, int k,
+        unsigned birth, unsigned survive){
+    return next_word(west_of(above, k), above[k], east_of(above, k),
+            west_of(row, k), row[k], east_of(row, k),
+            west_of(below, k), below[k], east_of(below, k),
+            birth, survive);
+}
+
+/* This function computes the last word of a row that is only partly
+ * used, and clears the bits past the last column. */
+__attribute__((always_inline))
+static inline uint64_t partial_last_word(const uint64_t *above,
+        const uint64_t *row, const uint64_t *below, int words, int cols,
+        unsigned birth, unsigned survive){
+    int k = words-1;
+    uint64_t next = next_word(west_of(above, k), above[k],
+            east_of_last(above, words, cols),
+            west_of(row, k), row[k], east_of_last(row, words, cols),
+            west_of(below, k), below[k], east_of_last(below, words, cols),
+            birth, survive);
+    return next & (~0ULL >> (63 - ((cols-1) & 63)));
+}
+
+/* This function returns the last word in k0..k1 that the regular
+ * (branch-free) word update handles: everything but a partly used last
+ * word of the row. */
+static inline int uniform_end(int k1, int words, int cols){
+    if (k1 == words-1 && (cols & 63) != 0){
+        return k1-1;
+    }
+    return k1;
+}
+
+/* This function counts how many more live cells words k0..k1 of out
+ * have than the same words of row: the live count change for that part
+ * of the row. It also ORs the bits that changed into *changed, and if
+ * born isn't NULL, adds the cells that came alive to *born. The words
+ * were just written, so they are still in L1. */
+static inline int live_delta(const uint64_t *row, const uint64_t *out,
+        int k0, int k1, uint64_t *changed, int *born){
+    int delta = 0;
+
+    for (int k = k0; k <= k1; k++){
+        delta += __builtin_popcountll(out[k]) - __builtin_popcountll(row[k]);
+        *changed |= out[k] ^ row[k];
+        if (born){
+            *born += __builtin_popcountll(out[k] & ~row[k]);
+        }
+    }
+    return delta;
+}
+
+/* scalar row kernel: one word per step */
+__attribute__((always_inline))
+static inline int row_scalar(ROW_PARAMS, unsigned birth, unsigned survive){
+    int k, delta = 0, born = 0;
+    int *count = births ? &born : NULL;
+    uint64_t diff = 0;
+    int last = uniform_end(k1, words, cols);
+
+    for (k = k0; k <= last; k++){
+        uint64_t next = scalar_word(above, row, below, k, birth, survive);
+        delta += __builtin_popcountll(next) - __builtin_popcountll(row[k]);
+        diff |= next ^ row[k];
+        if (births){
+            born += __builtin_popcountll(next & ~row[k]);
+        }
+        out[k] = next;
+    }
+    if (last < k1 && k0 <= k1){
+        out[k1] = partial_last_word(above, row, below, words, cols,
+                birth, survive);
+        delta += live_delta(row, out, k1, k1, &diff, count);
+    }
+    *changed |= diff;
+    if (births){
+        *births += born;
+    }
+    return delta;
+}
+
+/* This macro defines the pieces of a block kernel for one vector type of
+ * lanes words:
+ *   fn_hsum: the east + self + west sums of words k.. of a row, as the
+ *            ones and the twos of each sum
+ *   fn_next: words k.. of the next round of a row, from the sums of the
+ *            rows above and below and of the row itself. A cell's own
+ *            row only adds its east and west neighbors, which is the sum
+ *            less the cell: for a dead cell the sum as it is, and for a
+ *            live one the sum less 1.
+ */
+#define DEFINE_BLOCK_PIECES(fn, type, apply, attrs) \
+attrs static inline type fn##_load(const uint64_t *p){ \
+    type v; \
+    memcpy(&v, p, sizeof(v)); \
+    return v; \
+} \
+\
+attrs static inline void fn##_store(uint64_t *p, type v){ \
+    memcpy(p, &v, sizeof(v)); \
+} \
+\
+attrs static inline void fn##_hsum(const uint64_t *row, int k, \
+        uint64_t *ones, uint64_t *twos){ \
+    type c = fn##_load(row + k); \
+    type w = (c << 1) | (fn##_load(row + k - 1) >> 63); \
+    type e = (c >> 1) | (fn##_load(row + k + 1) << 63); \
+    type x = w ^ c; \
+\
+    fn##_store(ones, x ^ e); \
+    fn##_store(twos, (w & c) | (x & e)); \
+} \
+\
+attrs static inline void fn##_next(const uint64_t *row, uint64_t *out, \
+        int k, int i, uint64_t *const *ones, uint64_t *const *twos, \
+        unsigned birth, unsigned survive){ \
+    type c = fn##_load(row + k); \
+    type h1 = fn##_load(ones[1] + i), h2 = fn##_load(twos[1] + i); \
+    type s0 = fn##_load(ones[0] + i), c0 = fn##_load(twos[0] + i); \
+    type s2 = fn##_load(ones[2] + i), c2 = fn##_load(twos[2] + i); \
+    type s1 = h1 ^ c, c1 = h2 & (h1 | ~c); \
+    type x = s0 ^ s1; \
+    type all = x ^ s2, t = (s0 & s1) | (x & s2); \
+\
+    if (IS_CONWAY(birth, survive)){ \
+        fn##_store(out + k, (c0 ^ c1 ^ c2 ^ t) & \
+                ~((c0 & c1) | (c2 & t)) & (all | c)); \
+    } else { \
+        fn##_store(out + k, apply(all, c0, c1, c2, t, c, birth, survive)); \
+    } \
+}
+
+/* This macro defines a block kernel body for a vector type. The block is
+ * done in parts of STRIP_ROWS rows by STRIP_WORDS words, left to right
+ * and then top to bottom, each with a window of its own. The words that
+ * don't fill a whole vector are done with the pieces for a vector of half
+ * as many lanes (the blocks gol hands out are 4 words wide), and the rest,
+ * with a partly used last word, with the one-word pieces. */
+#define DEFINE_BLOCK_BODY(fn, pieces, lanes, half, half_lanes, attrs) \
+attrs static inline int fn(BLOCK_PARAMS, unsigned birth, \
+        unsigned survive){ \
+    uint64_t sums[2][3][STRIP_WORDS] __attribute__((aligned(64))); \
+    uint64_t *ones[3], *twos[3], *swap; \
+    uint64_t diff = 0; \
+    int delta = 0, born = 0, r0, r1, a, b, last, k; \
+    int *count = births ? &born : NULL; \
+\
+    for (r0 = 0; r0 < n; r0 += STRIP_ROWS){ \
+        r1 = (r0 + STRIP_ROWS < n) ? r0 + STRIP_ROWS - 1 : n - 1; \
+        for (a = k0; a <= k1; a += STRIP_WORDS){ \
+            b = (a + STRIP_WORDS - 1 < k1) ? a + STRIP_WORDS - 1 : k1; \
+            last = uniform_end(b, words, cols); \
+            for (int i = 0; i < 3; i++){ \
+                ones[i] = sums[0][i]; \
+                twos[i] = sums[1][i]; \
+            } \
+\
+            for (int y = r0 - 1; y <= r1 + 1; y++){ \
+                const uint64_t *row = in + y*(ptrdiff_t)stride; \
+\
+                /* the sums of row y go in the bottom of the window */ \
+                for (k = a; k + lanes - 1 <= last; k += lanes){ \
+                    pieces##_hsum(row, k, ones[2] + k - a, \
+                            twos[2] + k - a); \
+                } \
+                for (; k + half_lanes - 1 <= last; k += half_lanes){ \
+                    half##_hsum(row, k, ones[2] + k - a, \
+                            twos[2] + k - a); \
+                } \
+                for (; k <= last; k++){ \
+                    block_x1_hsum(row, k, ones[2] + k - a, \
+                            twos[2] + k - a); \
+                } \
+                if (last < b){ \
+                    uint64_t w = west_of(row, b), c = row[b]; \
+                    uint64_t e = east_of_last(row, words, cols); \
+                    ones[2][b-a] = w ^ c ^ e; \
+                    twos[2][b-a] = (w & c) | ((w ^ c) & e); \
+                } \
+\
+                /* with the row below in, row y - 1 can be made */ \
+                if (y > r0){ \
+                    const uint64_t *mid = row - stride; \
+                    uint64_t *dst = out + (y-1)*(ptrdiff_t)stride; \
+                    for (k = a; k + lanes - 1 <= b; k += lanes){ \
+                        pieces##_next(mid, dst, k, k - a, ones, twos, \
+                                birth, survive); \
+                    } \
+                    for (; k + half_lanes - 1 <= b; k += half_lanes){ \
+                        half##_next(mid, dst, k, k - a, ones, twos, \
+                                birth, survive); \
+                    } \
+                    for (; k <= b; k++){ \
+                        block_x1_next(mid, dst, k, k - a, ones, twos, \
+                                birth, survive); \
+                    } \
+                    if (last < b){ \
+                        dst[b] &= ~0ULL >> (63 - ((cols-1) & 63)); \
+                    } \
+                    delta += live_delta(mid, dst, a, b, &diff, count); \
+                } \
+\
+                /* roll the window down a row */ \
+                swap = ones[0]; ones[0] = ones[1]; ones[1] = ones[2]; \
+                ones[2] = swap; \
+                swap = twos[0]; twos[0] = twos[1]; twos[1] = twos[2]; \
+                twos[2] = swap; \
+            } \
+        } \
+    } \
+    *changed |= diff; \
+    if (births){ \
+        *births += born; \
+    } \
+    return delta; \
+}
+
+DEFINE_BLOCK_PIECES(block_x1, uint64_t, apply_rule,
+        __attribute__((always_inline)))
+DEFINE_BLOCK_BODY(block_scalar, block_x1, 1, block_x1, 1,
+        __attribute__((always_inline)))
+
+#ifdef HAVE_X86_KERNELS
+
+DEFINE_APPLY_RULE(apply_rule_avx2, __m256i,
+        __attribute__((target("avx2"), always_inline)))
+DEFINE_APPLY_RULE(apply_rule_avx512, __m512i,
+        __attribute__((target("avx512f"), always_inline)))
+
+/* AVX2 row kernel: four words (256 cells) per step. Each word reads its
+ * east and west neighbor words with unaligned loads one word over, which
+ * reach into the ghost words at the ends of the row. */
+__attribute__((target("avx2,popcnt"), always_inline))
+static inline int row_avx2(ROW_PARAMS, unsigned birth, unsigned survive){
+    int k = k0, delta = 0, born = 0;
+    int *count = births ? &born : NULL;
+    uint64_t diff = 0;
+    int last = uniform_end(k1, words, cols);
+
+    for (; k + 3 <= last; k += 4){
+        const uint64_t *r[3] = { above, row, below };
+        __m256i w[3], c[3], e[3];
+
+        for (int i = 0; i < 3; i++){
+            __m256i mid = _mm256_loadu_si256((const __m256i *)(r[i]+k));
+            __m256i lo = _mm256_loadu_si256((const __m256i *)(r[i]+k-1));
+            __m256i hi = _mm256_loadu_si256((const __m256i *)(r[i]+k+1));
+            c[i] = mid;
+            w[i] = _mm256_or_si256(_mm256_slli_epi64(mid, 1),
+                    _mm256_srli_epi64(lo, 63));
+            e[i] = _mm256_or_si256(_mm256_srli_epi64(mid, 1),
+                    _mm256_slli_epi64(hi, 63));
+        }
+
+        //same adder network as next_word, four words wide
+        __m256i t0 = _mm256_xor_si256(w[0], c[0]);
+        __m256i s0 = _mm256_xor_si256(t0, e[0]);
+        __m256i c0 = _mm256_or_si256(_mm256_and_si256(w[0], c[0]),
+                _mm256_and_si256(t0, e[0]));
+        __m256i t2 = _mm256_xor_si256(w[2], c[2]);
+        __m256i s2 = _mm256_xor_si256(t2, e[2]);
+        __m256i c2 = _mm256_or_si256(_mm256_and_si256(w[2], c[2]),
+                _mm256_and_si256(t2, e[2]));
+        __m256i s1 = _mm256_xor_si256(w[1], e[1]);
+        __m256i c1 = _mm256_and_si256(w[1], e[1]);
+        __m256i t1 = _mm256_xor_si256(s0, s1);
+        __m256i ones = _mm256_xor_si256(t1, s2);
+        __m256i t = _mm256_or_si256(_mm256_and_si256(s0, s1),
+                _mm256_and_si256(t1, s2));
+        __m256i next;
+        if (IS_CONWAY(birth, survive)){
+            __m256i par = _mm256_xor_si256(_mm256_xor_si256(c0, c1),
+                    _mm256_xor_si256(c2, t));
+            __m256i two = _mm256_or_si256(_mm256_and_si256(c0, c1),
+                    _mm256_and_si256(c2, t));
+            __m256i one_two = _mm256_andnot_si256(two, par);
+            next = _mm256_and_si256(one_two, _mm256_or_si256(ones, c[1]));
+        } else {
+            next = apply_rule_avx2(ones, c0, c1, c2, t, c[1], birth,
+                    survive);
+        }
+
+        _mm256_storeu_si256((__m256i *)(out+k), next);
+        delta += live_delta(row, out, k, k+3, &diff, count);
+    }
+
+    for (; k <= last; k++){
+        out[k] = scalar_word(above, row, below, k, birth, survive);
+        delta += live_delta(row, out, k, k, &diff, count);
+    }
+    if (last < k1 && k0 <= k1){
+        out[k1] = partial_last_word(above, row, below, words, cols,
+                birth, survive);
+        delta += live_delta(row, out, k1, k1, &diff, count);
+    }
+    *changed |= diff;
+    if (births){
+        *births += born;
+    }
+    return delta;
+}
+
+/* AVX-512 row kernel: eight words (512 cells) per step, loaded the same
+ * way as in the AVX2 kernel. The adders use
+ * ternary logic, so each 3-input sum and carry is a single instruction
+ * (0x96 is a^b^c, 0xe8 is the majority of a, b, c). */
+__attribute__((target("avx512f,popcnt"), always_inline))
+static inline int row_avx512(ROW_PARAMS, unsigned birth, unsigned survive){
+    int k = k0, delta = 0, born = 0;
+    int *count = births ? &born : NULL;
+    uint64_t diff = 0;
+    int last = uniform_end(k1, words, cols);
+
+    for (; k + 7 <= last; k += 8){
+        const uint64_t *r[3] = { above, row, below };
+        __m512i w[3], c[3], e[3];
+
+        for (int i = 0; i < 3; i++){
+            __m512i mid = _mm512_loadu_si512(r[i]+k);
+            __m512i lo = _mm512_loadu_si512(r[i]+k-1);
+            __m512i hi = _mm512_loadu_si512(r[i]+k+1);
+            c[i] = mid;
+            w[i] = _mm512_or_si512(_mm512_slli_epi64(mid, 1),
+                    _mm512_srli_epi64(lo, 63));
+            e[i] = _mm512_or_si512(_mm512_srli_epi64(mid, 1),
+                    _mm512_slli_epi64(hi, 63));
+        }
+
+        __m512i s0 = _mm512_ternarylogic_epi64(w[0], c[0], e[0], 0x96);
+        __m512i c0 = _mm512_ternarylogic_epi64(w[0], c[0], e[0], 0xe8);
+        __m512i s2 = _mm512_ternarylogic_epi64(w[2], c[2], e[2], 0x96);
+        __m512i c2 = _mm512_ternarylogic_epi64(w[2], c[2], e[2], 0xe8);
+        __m512i s1 = _mm512_xor_si512(w[1], e[1]);
+        __m512i c1 = _mm512_and_si512(w[1], e[1]);
+        __m512i ones = _mm512_ternarylogic_epi64(s0, s1, s2, 0x96);
+        __m512i t = _mm512_ternarylogic_epi64(s0, s1, s2, 0xe8);
+        __m512i next;
+        if (IS_CONWAY(birth, survive)){
+            __m512i par = _mm512_xor_si512(_mm512_xor_si512(c0, c1),
+                    _mm512_xor_si512(c2, t));
+            __m512i two = _mm512_or_si512(_mm512_and_si512(c0, c1),
+                    _mm512_and_si512(c2, t));
+            next = _mm512_and_si512(_mm512_andnot_si512(two, par),
+                    _mm512_or_si512(ones, c[1]));
+        } else {
+            next = apply_rule_avx512(ones, c0, c1, c2, t, c[1], birth,
+                    survive);
+        }
+
+        _mm512_storeu_si512(out+k, next);
+        delta += live_delta(row, out, k, k+7, &diff, count);
+    }
+
+    for (; k <= last; k++){
+        out[k] = scalar_word(above, row, below, k, birth, survive);
+        delta += live_delta(row, out, k, k, &diff, count);
+    }
+    if (last < k1 && k0 <= k1){
+        out[k1] = partial_last_word(above, row, below, words, cols,
+                birth, survive);
+        delta += live_delta(row, out, k1, k1, &diff, count);
+    }
+    *changed |= diff;
+    if (births){
+        *births += born;
+    }
+    return delta;
+}
+
+DEFINE_APPLY_RULE(apply_rule_x4, u64x4,
+        __attribute__((target("avx2"), always_inline)))
+DEFINE_BLOCK_PIECES(block_x4, u64x4, apply_rule_x4,
+        __attribute__((target("avx2"), always_inline)))
+DEFINE_BLOCK_BODY(block_avx2, block_x4, 4, block_x1, 1,
+        __attribute__((target("avx2,popcnt"), always_inline)))
+
+DEFINE_APPLY_RULE(apply_rule_x8, u64x8,
+        __attribute__((target("avx512f"), always_inline)))
+DEFINE_BLOCK_PIECES(block_x8, u64x8, apply_rule_x8,
+        __attribute__((target("avx512f"), always_inline)))
+DEFINE_BLOCK_BODY(block_avx512, block_x8, 8, block_x4, 4,
+        __attribute__((target("avx512f,popcnt"), always_inline)))
+
+#endif  /* HAVE_X86_KERNELS */
+
+/* The kernels themselves: each row kernel body above, once for each rule
+ * in RULES and once for any other rule */
+#define SCALAR_KERNEL(tag, name, text, birth, survive) \
+static int row_scalar_##tag(ROW_PARAMS){ \
+    return row_scalar(ROW_ARGS, birth, survive); \
+} \
+static int block_scalar_##tag(BLOCK_PARAMS){ \
+    return block_scalar(BLOCK_ARGS, birth, survive); \
+}
+RULES(SCALAR_KERNEL)
+SCALAR_KERNEL(any, "", "", any_birth, any_survive)
+
+#ifdef HAVE_X86_KERNELS
+#define AVX2_KERNEL(tag, name, text, birth, survive) \
+__attribute__((target("avx2,popcnt"))) \
+static int row_avx2_##tag(ROW_PARAMS){ \
+    return row_avx2(ROW_ARGS, birth, survive); \
+} \
+__attribute__((target("avx2,popcnt"))) \
+static int block_avx2_##tag(BLOCK_PARAMS){ \
+    return block_avx2(BLOCK_ARGS, birth, survive); \
+}
+RULES(AVX2_KERNEL)
+AVX2_KERNEL(any, "", "", any_birth, any_survive)
+
+#define AVX512_KERNEL(tag, name, text, birth, survive) \
+__attribute__((target("avx512f,popcnt"))) \
+static int row_avx512_##tag(ROW_PARAMS){ \
+    return row_avx512(ROW_ARGS, birth, survive); \
+} \
+__attribute__((target("avx512f,popcnt"))) \
+static int block_avx512_##tag(BLOCK_PARAMS){ \
+    return block_avx512(BLOCK_ARGS, birth, survive); \
+}
+RULES(AVX512_KERNEL)
+AVX512_KERNEL(any, "", "", any_birth, any_survive)
+#endif
+
+#define SCALAR_ROW(tag, name, text, birth, survive)  row_scalar_##tag,
+#define AVX2_ROW(tag, name, text, birth, survive)    row_avx2_##tag,
+#define AVX512_ROW(tag, name, text, birth, survive)  row_avx512_##tag,
+#define SCALAR_BLOCK(tag, name, text, birth, survive)  block_scalar_##tag,
+#define AVX2_BLOCK(tag, name, text, birth, survive)    block_avx2_##tag,
+#define AVX512_BLOCK(tag, name, text, birth, survive)  block_avx512_##tag,
+
+/* The kernels for each instruction set, fastest first */
+static const struct kernel_set {
+    const char *name;
+    const char *feature;        // CPU feature it needs, NULL for none
+    row_kernel_fn rows[NUM_RULES]; // one for each rule in rules[]
+    row_kernel_fn any;          // for any other rule
+    block_kernel_fn blocks[NUM_RULES]; // the same for block kernels
+    block_kernel_fn block_any;
+} kernels[] = {
+#ifdef HAVE_X86_KERNELS
+    { "avx512", "avx512f", { RULES(AVX512_ROW) }, row_avx512_any,
+        { RULES(AVX512_BLOCK) }, block_avx512_any },
+    { "avx2", "avx2", { RULES(AVX2_ROW) }, row_avx2_any,
+        { RULES(AVX2_BLOCK) }, block_avx2_any },
+#endif
+    { "scalar", NULL, { RULES(SCALAR_ROW) }, row_scalar_any,
+        { RULES(SCALAR_BLOCK) }, block_scalar_any },
+};
+
+/* This function checks if the CPU can run a set of kernels.
+ * returns 1 if it can, 0 if not */
+static int kernel_supported(const struct kernel_set *k){
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (k->feature && strcmp(k->feature, "avx512f") == 0){
+        return __builtin_cpu_supports("avx512f");
+    }
+    if (k->feature && strcmp(k->feature, "avx2") == 0){
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return k->feature == NULL;
+}
+
+/* This function picks the kernel to run, either the one asked for on the
+ * command line or, for "auto", the first supported one in kernels[]
+ * (they are listed fastest first), in its version for the rule.
+ * param name: kernel name, or NULL/"auto" to pick from CPUID
+ * param rule: the rule the kernel plays
+ * returns the kernel, or NULL if it is unknown or not supported
+ */
+const struct kernel *kernel_select(const char *name, struct rule rule){
+    static struct kernel selected;
+    const struct kernel_set *set = NULL;
+    int n = sizeof(kernels)/sizeof(kernels[0]);
+
+    for (int i = 0; i < n && !set; i++){
+        if (name == NULL || strcmp(name, "auto") == 0){
+            if (kernel_supported(&kernels[i])){
+                set = &kernels[i];
+            }
+        }
+        else if (strcmp(name, kernels[i].name) == 0){
+            if (!kernel_supported(&kernels[i])){
+                return NULL;
+            }
+            set = &kernels[i];
+        }
+    }
+    if (!set){
+        return NULL;
+    }
+
+    selected.name = set->name;
+    selected.row = set->any;
+    selected.block = set->block_any;
+    selected.rule = NULL;
+    any_birth = rule.birth;
+    any_survive = rule.survive;
+    for (int i = 0; i < NUM_RULES; i++){
+        if (rules[i].birth == rule.birth &&
+                rules[i].survive == rule.survive){
+            selected.row = set->rows[i];
+            selected.block = set->blocks[i];
+            selected.rule = rules[i].text;
+        }
+    }
+    return &selected;
+}
+
+/* This function reads the digits of one half of a rule.
+ * param text: the digits, up to end or a '/'
+ * param mask: set to the counts the digits name
+ * returns a pointer past the digits, or NULL if one isn't 0..8 */
+static const char *parse_counts(const char *text, uint16_t *mask){
+    *mask = 0;
+    for (; *text && *text != '/'; text++){
+        if (*text < '0' || *text > '8'){
+            return NULL;
+        }
+        *mask |= 1 << (*text - '0');
+    }
+    return text;
+}
+
+int rule_parse(const char *text, struct rule *rule){
+    uint16_t first, second;
+    const char *p = text;
+    int letters = 0;
+
+    for (int i = 0; i < NUM_RULES; i++){
+        if (strcasecmp(text, rules[i].name) == 0){
+            rule->birth = rules[i].birth;
+            rule->survive = rules[i].survive;
+            return 0;
+        }
+    }
+
+    //B.../S... or S.../B..., or the old survive/birth with no letters
+    if (*p == 'B' || *p == 'b' || *p == 'S' || *p == 's'){
+        letters = 1;
+        p++;
+    }
+    p = parse_counts(p, &first);
+    if (!p || *p != '/'){
+        return -1;
+    }
+    p++;
+    if (letters){
+        if (*p != ((text[0] | 0x20) == 'b' ? 'S' : 'B') &&
+                *p != ((text[0] | 0x20) == 'b' ? 's' : 'b')){
+            return -1;
+        }
+        p++;
+    }
+    p = parse_counts(p, &second);
+    if (!p || *p){
+        return -1;
+    }
+
+    if (letters && (text[0] | 0x20) == 'b'){
+        rule->birth = first;
+        rule->survive = second;
+    } else {
+        rule->survive = first;
+        rule->birth = second;
+    }
+    //B0 would bring the empty board to life
+    return (rule->birth & 1) ? -1 : 0;
+}
+
+void rule_format(struct rule rule, char *buf){
+    char *p = buf;
+
+    *p++ = 'B';
+    for (int n = 0; n <= 8; n++){
+        if ((rule.birth >> n) & 1){
+            *p++ = '0' + n;
+        }
+    }
+    *p++ = '/';
+    *p++ = 'S';
+    for (int n = 0; n <= 8; n++){
+        if ((rule.survive >> n) & 1){
+            *p++ = '0' + n;
+        }
+    }
+    *p = '\0';
+}
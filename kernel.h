@@ -0,0 +1,78 @@
+#ifndef __KERNEL_H__
+#define __KERNEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* This file declares the next-round kernels for the bit-packed board.
+ * Every kernel computes the same thing; they differ only in how many
+ * words of cells they handle per instruction, and in the rule they are
+ * built for. */
+
+/* A Life-like rule in B/S notation: a dead cell with n live neighbors
+ * comes alive if bit n of birth is set, and a live cell with n live
+ * neighbors stays alive if bit n of survive is set. */
+struct rule {
+    uint16_t birth;
+    uint16_t survive;
+};
+
+/* Conway's rule, B3/S23 */
+#define RULE_CONWAY  ((struct rule){ 1 << 3, (1 << 2) | (1 << 3) })
+
+/* A row kernel computes words k0..k1 of one row of the next round.
+ *   above, row, below: the current round's row and the rows around it
+ *   out: the next round's row
+ *   words: number of 64-bit words in a row
+ *   cols: number of cells in a row (the board width)
+ * Rows are padded with ghost cells copied from the opposite edge of the
+ * board: row[-1] holds the last column in bit 63 and row[words] holds
+ * column 0 in bit 0 (and the rows above row 0 and below the last row are
+ * ghost copies too). Bits past the last column in out are cleared.
+ * Returns the change in live cells from row to out over words k0..k1,
+ * counted while the words are computed, and ORs every bit that changed
+ * into *changed. If births isn't NULL, the number of cells that came
+ * alive is added to *births too (the rest of the change is deaths). */
+typedef int (*row_kernel_fn)(const uint64_t *above, const uint64_t *row,
+        const uint64_t *below, uint64_t *out, int k0, int k1,
+        int words, int cols, uint64_t *changed, int *births);
+
+/* A block kernel computes words k0..k1 of n rows of the next round in
+ * one go, the same as calling the row kernel on each of them, but with
+ * less work per row (see kernel.c).
+ *   in: row 0 of the current round; row i starts at in + i*stride, for
+ *       i from -1 to n (rows -1 and n are only read)
+ *   out: row 0 of the next round, laid out the same way
+ * The other arguments and the return value are as for a row kernel, over
+ * all n rows. */
+typedef int (*block_kernel_fn)(const uint64_t *in, uint64_t *out,
+        size_t stride, int n, int k0, int k1, int words, int cols,
+        uint64_t *changed, int *births);
+
+struct kernel {
+    const char *name;   // name used on the command line
+    row_kernel_fn row;  // the row kernel
+    block_kernel_fn block;  // the block kernel
+    const char *rule;   // the rule row was built for, or NULL if it reads
+                        // the rule from a table as it goes
+};
+
+/* Picks a kernel by name ("scalar", "avx2", "avx512"), or the fastest
+ * kernel this CPU supports when name is NULL or "auto", for the rule.
+ * Common rules have kernels built just for them, which cost the same as
+ * Conway's; any other rule gets a kernel that looks it up as it goes.
+ * Returns NULL if the name is unknown or the CPU can't run that kernel.
+ * Only one rule can be in use at a time. */
+const struct kernel *kernel_select(const char *name, struct rule rule);
+
+/* Reads a rule: B/S notation ("B36/S23", any case), the older S/B
+ * notation ("23/36"), or the name of a common rule ("highlife").
+ * Rules with B0 are refused, since they bring empty space to life, and
+ * every engine relies on empty space staying empty.
+ * returns 0 and fills in *rule, or -1 if text isn't such a rule */
+int rule_parse(const char *text, struct rule *rule);
+
+/* Writes a rule in B/S notation to buf, which must hold 24 chars. */
+void rule_format(struct rule rule, char *buf);
+
+#endif  /* __KERNEL_H__ */
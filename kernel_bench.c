@@ -0,0 +1,280 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements kernel_bench, which compares the two ways of
+ * computing a round with the kernels in kernel.c on a random board: one
+ * row kernel call per row, and one block kernel call for all the rows.
+ * It plays the same rounds both ways a few times, checks that they agree,
+ * and reports the fastest time per round and, where the kernel lets us
+ * (see perf_event_open and /proc/sys/kernel/perf_event_paranoid), the
+ * hardware counters for cycles, instructions, cache references and
+ * misses, and L1 data cache read misses, per round.
+ *
+ * Going row by row, each row is read three times, and on a board whose
+ * rows are too wide for L1 to hold three of them and the row being
+ * written (the default board's rows are 8KB), it has left L1 before it is
+ * read again. The block kernel reads each row once.
+ *
+ * To run:
+ * ./kernel_bench                       # 1024x65536, 20 rounds
+ * ./kernel_bench -r 2048 -c 2048 -i 200 -k scalar -R highlife
+ *
+ * Options:
+ *   -r rows -c cols -i rounds   board size and rounds per trial
+ *   -n trials     trials of each way, the fastest is reported (default 5)
+ *   -d density    chance that a cell starts out alive (default 0.3)
+ *   -S seed       seed for the board (default 1)
+ *   -k kernel     as for gol
+ *   -R rule       as for gol
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "grid.h"
+#include "kernel.h"
+
+/* The hardware counters read, in the order they're reported */
+#define NUM_COUNTERS  (5)
+
+static const struct counter_type {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} counter_types[NUM_COUNTERS] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-refs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "L1d-read-misses", PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+/* This function makes a board of random cells.
+ * param g: the board's layout
+ * param density: chance that a cell is alive
+ * param seed: seed for the cells
+ * returns the board */
+static uint64_t *make_board(const struct grid *g, double density,
+        unsigned seed){
+    uint64_t *cells = grid_alloc(g), *row;
+
+    srand(seed);
+    for (int r = 0; r < g->rows; r++){
+        row = grid_row(g, cells, r);
+        for (int c = 0; c < g->cols; c++){
+            if (rand() < density*RAND_MAX){
+                grid_set_bit(row, c);
+            }
+        }
+    }
+    grid_fill_ghosts(g, cells);
+    return cells;
+}
+
+/* This function opens the hardware counters that the kernel lets us
+ * have, as one group led by the first.
+ * param fds: the counters' file descriptors, -1 for the ones we can't have
+ * returns the group leader, -1 if there are no counters at all */
+static int open_counters(int *fds){
+    struct perf_event_attr attr;
+    int leader = -1;
+
+    for (int i = 0; i < NUM_COUNTERS; i++){
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter_types[i].type;
+        attr.config = counter_types[i].config;
+        attr.disabled = (leader == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fds[i] != -1 && leader == -1){
+            leader = fds[i];
+        }
+    }
+    return leader;
+}
+
+/* This function plays rounds of a board one way, timing it and reading
+ * the counters.
+ * param block: 1 for the block kernel, 0 for the row kernel row by row
+ * param counts: where the counters' totals go, -1 for the missing ones
+ * returns the seconds it took */
+static double play(const struct kernel *kernel, const struct grid *g,
+        uint64_t **b, uint64_t **next, int rounds, int block,
+        long long *counts){
+    uint64_t *swap;
+    struct timespec start, end;
+    int fds[NUM_COUNTERS], leader;
+    uint64_t changed = 0;
+
+    leader = open_counters(fds);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (leader != -1){
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    for (int i = 0; i < rounds; i++){
+        if (block){
+            kernel->block(grid_row(g, *b, 0), grid_row(g, *next, 0),
+                    g->stride, g->rows, 0, g->words-1, g->words, g->cols,
+                    &changed, NULL);
+        } else {
+            for (int r = 0; r < g->rows; r++){
+                kernel->row(grid_row(g, *b, r-1), grid_row(g, *b, r),
+                        grid_row(g, *b, r+1), grid_row(g, *next, r), 0,
+                        g->words-1, g->words, g->cols, &changed, NULL);
+            }
+        }
+        grid_fill_ghosts(g, *next);
+        swap = *b;
+        *b = *next;
+        *next = swap;
+    }
+    if (leader != -1){
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (int i = 0; i < NUM_COUNTERS; i++){
+        counts[i] = -1;
+        if (fds[i] != -1){
+            if (read(fds[i], &counts[i], sizeof(counts[i])) !=
+                    sizeof(counts[i])){
+                counts[i] = -1;
+            }
+            close(fds[i]);
+        }
+    }
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+}
+
+/* This function prints a row of results, per round. */
+static void print_result(const char *way, double secs, long long *counts,
+        int rounds){
+    printf("%-6s %12.3f", way, secs*1e3/rounds);
+    for (int i = 0; i < NUM_COUNTERS; i++){
+        if (counts[i] < 0){
+            printf(" %16s", "n/a");
+        } else {
+            printf(" %16lld", counts[i]/rounds);
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv){
+    struct grid g;
+    uint64_t *start, *b, *next, *after;
+    long long counts[2][NUM_COUNTERS], trial[NUM_COUNTERS];
+    double secs[2] = {0, 0}, t;
+    int rows = 1024, cols = 65536, rounds = 20, trials = 5, ret;
+    double density = 0.3;
+    unsigned seed = 1;
+    const char *kernel_name = NULL;
+    const struct kernel *kernel;
+    struct rule rule = RULE_CONWAY;
+    char text[24];
+    size_t size;
+
+    while ((ret = getopt(argc, argv, "r:c:i:n:d:S:k:R:")) != -1){
+        switch (ret){
+            case 'r': rows = atoi(optarg); break;
+            case 'c': cols = atoi(optarg); break;
+            case 'i': rounds = atoi(optarg); break;
+            case 'n': trials = atoi(optarg); break;
+            case 'd': density = atof(optarg); break;
+            case 'S': seed = strtoul(optarg, NULL, 10); break;
+            case 'k': kernel_name = optarg; break;
+            case 'R':
+                if (rule_parse(optarg, &rule) != 0){
+                    printf("Unknown rule: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            default:
+                printf("usage: %s [-r rows] [-c cols] [-i rounds] "
+                        "[-n trials] [-d density] [-S seed] [-k kernel] "
+                        "[-R rule]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (rows < 1 || cols < 1 || rounds < 1 || trials < 1){
+        printf("Rows, columns, rounds and trials must be at least 1.\n");
+        exit(1);
+    }
+    kernel = kernel_select(kernel_name, rule);
+    if (kernel == NULL){
+        printf("Kernel %s is unknown or not supported on this CPU.\n",
+                kernel_name);
+        exit(1);
+    }
+
+    rule_format(rule, text);
+    printf("%dx%d board, %d rounds, best of %d, %s kernel, rule %s\n",
+            rows, cols, rounds, trials, kernel->name, text);
+    printf("%-6s %12s", "way", "ms/round");
+    for (int i = 0; i < NUM_COUNTERS; i++){
+        printf(" %16s", counter_types[i].name);
+    }
+    printf("\n");
+
+    //every trial of both ways plays the same board from the same start,
+    //taking turns so that both see the same noise from the rest of the
+    //machine
+    grid_init(&g, rows, cols);
+    start = make_board(&g, density, seed);
+    b = grid_alloc(&g);
+    next = grid_alloc(&g);
+    size = grid_bytes(&g);
+    after = malloc(size);
+    if (after == NULL){
+        perror("malloc");
+        exit(1);
+    }
+    for (int i = 0; i < trials; i++){
+        for (int way = 0; way < 2; way++){
+            memcpy(b, start, size);
+            memset(next, 0, size);
+            t = play(kernel, &g, &b, &next, rounds, way, trial);
+            if (i == 0 && way == 0){
+                memcpy(after, b, size);
+            } else if (memcmp(after, b, size) != 0){
+                printf("The row and block kernels don't agree!\n");
+                exit(1);
+            }
+            if (i == 0 || t < secs[way]){
+                secs[way] = t;
+                memcpy(counts[way], trial, sizeof(trial));
+            }
+        }
+    }
+
+    print_result("row", secs[0], counts[0], rounds);
+    print_result("block", secs[1], counts[1], rounds);
+    if (counts[0][3] > 0 && counts[1][3] >= 0){
+        printf("block has %.2fx the cache misses of row\n",
+                (double)counts[1][3] / counts[0][3]);
+    }
+    if (counts[0][4] > 0 && counts[1][4] >= 0){
+        printf("block has %.2fx the L1 data read misses of row\n",
+                (double)counts[1][4] / counts[0][4]);
+    }
+    printf("block takes %.2fx the time of row\n", secs[1] / secs[0]);
+
+    free(after);
+    grid_free(&g, start);
+    grid_free(&g, b);
+    grid_free(&g, next);
+    return 0;
+}
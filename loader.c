@@ -0,0 +1,500 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the parallel input file loader (see loader.h).
+ *
+ * The body of the file is cut into one chunk per worker of the pool the
+ * program plays on (pool.h), with the cuts
+ * moved forward to the next word (or RLE run) so nothing is split. What a
+ * chunk means depends on what came before it, so there are two passes:
+ *   1. each thread measures its chunk: for a coordinate list, how many
+ *      numbers are in it; for RLE, how many rows it ends and how far
+ *      along the row it leaves off
+ *   2. after adding those up, each thread knows where its chunk starts
+ *      (which number of the list, or which cell of the pattern) and
+ *      parses it, ORing the live cells into the board
+ * Two threads can set cells in the same word, so the ORs are atomic.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "loader.h"
+
+/* Chunks smaller than this aren't worth a thread */
+#define MIN_CHUNK      (1 << 16)
+
+/* Numbers are not read past this many digits' worth */
+#define MAX_NUMBER     (1L << 40)
+
+/* What went wrong in a chunk */
+#define ERR_NONE       (0)
+#define ERR_FORMAT     (1)   // a character that doesn't belong
+#define ERR_OFF        (2)   // a live cell off the board
+
+/* One thread's share of the file, and what it found in it */
+struct chunk {
+    const char *text;       // the whole file
+    size_t len;             // length of the whole file
+    size_t begin, end;      // this chunk's part of the body
+    const struct load_header *hdr;
+    uint64_t *board;
+    size_t stride;
+    int rows, cols, top, left;
+
+    // pass 1
+    long numbers;   // LOAD_CELLS: whitespace separated words in the chunk
+    long dy;        // LOAD_RLE: rows ended ($) in the chunk
+    long dx;        // LOAD_RLE: cells along the row since the last $,
+                    //           or since the chunk started if it has none
+    int newline;    // LOAD_RLE: the chunk ends a row
+    int ended;      // LOAD_RLE: the chunk has the ! that ends the pattern
+
+    // pass 2
+    long first;     // LOAD_CELLS: index in the list of the first word
+    long x, y;      // LOAD_RLE: pattern cell the chunk starts at
+    int skip;       // LOAD_RLE: the chunk is past the end of the pattern
+    int error;      // ERR_ code of the first problem found
+    long bad_r, bad_c;  // the cell, for ERR_OFF
+
+    void *(*fn)(void *);    // the pass run_chunk runs, NULL for nothing
+};
+
+static inline int is_space(char c){
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+        c == '\f';
+}
+
+static inline int is_digit(char c){
+    return c >= '0' && c <= '9';
+}
+
+/* This function reads the whitespace separated word at *pos as an
+ * integer, and moves *pos past it.
+ * param end: where to stop looking
+ * param out: set to the integer
+ * returns 1 if it read an integer, 0 if there were no more words before
+ *         end, -1 if the word isn't an integer */
+static int scan_int(const char *text, size_t *pos, size_t end, long *out){
+    size_t p = *pos;
+    long v = 0;
+    int neg = 0;
+
+    while (p < end && is_space(text[p])){
+        p++;
+    }
+    *pos = p;
+    if (p >= end){
+        return 0;
+    }
+    if (text[p] == '-' || text[p] == '+'){
+        neg = (text[p] == '-');
+        p++;
+    }
+    if (p >= end || !is_digit(text[p])){
+        return -1;
+    }
+    for (; p < end && is_digit(text[p]); p++){
+        if (v < MAX_NUMBER){
+            v = v*10 + (text[p] - '0');
+        }
+    }
+    if (p < end && !is_space(text[p])){
+        return -1;
+    }
+    *pos = p;
+    *out = neg ? -v : v;
+    return 1;
+}
+
+/* This function sets cells c..c+n-1 of row r of the board. */
+static void set_run(struct chunk *ch, long r, long c, long n){
+    uint64_t *row = ch->board + (size_t)r*ch->stride;
+    uint64_t mask;
+    long k, b;
+
+    while (n > 0){
+        k = c/64;
+        b = c%64;
+        mask = (n >= 64 - b) ? ~0ULL << b : ((1ULL << n) - 1) << b;
+        __atomic_fetch_or(&row[k], mask, __ATOMIC_RELAXED);
+        n -= 64 - b;
+        c += 64 - b;
+    }
+}
+
+/* This function records the first problem in a chunk. */
+static void chunk_error(struct chunk *ch, int error, long r, long c){
+    if (ch->error == ERR_NONE){
+        ch->error = error;
+        ch->bad_r = r;
+        ch->bad_c = c;
+    }
+}
+
+/* pass 1 for a coordinate list: count the words in the chunk */
+static void *count_numbers(void *args){
+    struct chunk *ch = (struct chunk *)args;
+    int was_space = 1;
+
+    ch->numbers = 0;
+    for (size_t p = ch->begin; p < ch->end; p++){
+        if (!is_space(ch->text[p]) && was_space){
+            ch->numbers++;
+        }
+        was_space = is_space(ch->text[p]);
+    }
+    return NULL;
+}
+
+/* pass 2 for a coordinate list: read the pairs. A chunk that starts on a
+ * column finishes a pair from the chunk before it, so that number is
+ * skipped here, and a chunk that ends on a row reads its column from the
+ * next chunk. */
+static void *parse_numbers(void *args){
+    struct chunk *ch = (struct chunk *)args;
+    long limit = 2*ch->hdr->count;
+    long g = ch->first, v, r = 0;
+    size_t p = ch->begin;
+    int ret;
+
+    while (g < limit){
+        if (g % 2 == 0 && p >= ch->end){
+            break;
+        }
+        ret = scan_int(ch->text, &p, (g % 2 == 0) ? ch->end : ch->len, &v);
+        if (ret == 0){
+            break;
+        }
+        if (ret < 0){
+            chunk_error(ch, ERR_FORMAT, 0, 0);
+            break;
+        }
+        if (g % 2 == 0){
+            r = v;
+        } else if (g != ch->first){
+            if (r < 0 || r >= ch->rows || v < 0 || v >= ch->cols){
+                chunk_error(ch, ERR_OFF, r, v);
+                break;
+            }
+            set_run(ch, r, v, 1);
+        }
+        g++;
+    }
+    return NULL;
+}
+
+/* This function goes through the RLE runs of a chunk: in pass 1 (set is
+ * 0) it measures the chunk, and in pass 2 it sets the live cells too,
+ * starting from the chunk's place in the pattern. */
+static void walk_rle(struct chunk *ch, int set){
+    long n = 0, x = set ? ch->x : 0, y = set ? ch->y : 0;
+    char c;
+
+    ch->dy = 0;
+    ch->newline = 0;
+    ch->ended = 0;
+    for (size_t p = ch->begin; p < ch->end && !ch->ended; p++){
+        c = ch->text[p];
+        if (is_digit(c)){
+            if (n < MAX_NUMBER){
+                n = n*10 + (c - '0');
+            }
+            continue;
+        }
+        if (is_space(c)){
+            //line breaks can come anywhere, even inside a count
+            continue;
+        }
+        //a run with no count is one long
+        n = (n == 0) ? 1 : n;
+        if (c == 'b' || c == '.'){
+            x += n;
+        } else if (c == 'o'){
+            if (set){
+                if (ch->top + y >= ch->rows || ch->left + x + n > ch->cols){
+                    chunk_error(ch, ERR_OFF, ch->top + y, ch->left + x);
+                    return;
+                }
+                set_run(ch, ch->top + y, ch->left + x, n);
+            }
+            x += n;
+        } else if (c == '$'){
+            y += n;
+            ch->dy += n;
+            x = 0;
+            ch->newline = 1;
+        } else if (c == '!'){
+            ch->ended = 1;
+        } else {
+            if (set){
+                chunk_error(ch, ERR_FORMAT, 0, 0);
+                return;
+            }
+        }
+        n = 0;
+    }
+    ch->dx = x;
+}
+
+static void *measure_rle(void *args){
+    walk_rle((struct chunk *)args, 0);
+    return NULL;
+}
+
+static void *parse_rle(void *args){
+    struct chunk *ch = (struct chunk *)args;
+
+    if (!ch->skip){
+        walk_rle(ch, 1);
+    }
+    return NULL;
+}
+
+/* This function runs a chunk's pass on the pool worker it was given to;
+ * the workers past the last chunk have none. */
+static void *run_chunk(void *args){
+    struct chunk *ch = (struct chunk *)args;
+
+    if (ch->fn){
+        ch->fn(ch);
+    }
+    return NULL;
+}
+
+/* This function runs fn on the first n chunks, a worker of the pool
+ * each, or on the calling thread if there is one chunk or no pool.
+ * chunks has an entry for each of the pool's threads workers. */
+static void run_chunks(struct pool *pool, struct chunk *chunks, int threads,
+        int n, void *(*fn)(void *)){
+    if (pool == NULL || n == 1){
+        fn(&chunks[0]);
+        return;
+    }
+    for (int i = 0; i < threads; i++){
+        chunks[i].fn = (i < n) ? fn : NULL;
+    }
+    pool_start(pool, run_chunk, chunks, sizeof(struct chunk));
+    pool_wait(pool);
+}
+
+const char *load_map(const char *path, size_t *len){
+    struct stat st;
+    void *text;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0){
+        printf("Error: failed to open file: %s\n", path);
+        exit(1);
+    }
+    *len = st.st_size;
+    if (*len == 0){
+        close(fd);
+        return "";
+    }
+    text = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (text == MAP_FAILED){
+        perror("mmap: input file");
+        exit(1);
+    }
+    madvise(text, *len, MADV_SEQUENTIAL);
+    close(fd);
+    return text;
+}
+
+void load_unmap(const char *text, size_t len){
+    if (len > 0){
+        munmap((void *)text, len);
+    }
+}
+
+/* This function reads "name = value" from an RLE header line.
+ * returns 1 if it was there */
+static int rle_field(const char *text, size_t *pos, size_t end,
+        const char *name, long *value){
+    size_t p = *pos;
+
+    while (p < end && (is_space(text[p]) || text[p] == ',')){
+        p++;
+    }
+    if (p + strlen(name) > end || strncmp(text + p, name, strlen(name))){
+        return 0;
+    }
+    p += strlen(name);
+    while (p < end && text[p] == ' '){
+        p++;
+    }
+    if (p >= end || text[p] != '='){
+        return 0;
+    }
+    p++;
+    *value = 0;
+    while (p < end && text[p] == ' '){
+        p++;
+    }
+    if (p >= end || !is_digit(text[p])){
+        return 0;
+    }
+    for (; p < end && is_digit(text[p]); p++){
+        if (*value < MAX_NUMBER){
+            *value = *value*10 + (text[p] - '0');
+        }
+    }
+    *pos = p;
+    return 1;
+}
+
+int load_header(const char *text, size_t len, struct load_header *hdr){
+    size_t p = 0, eol;
+    long v[4];
+
+    memset(hdr, 0, sizeof(*hdr));
+    while (p < len && is_space(text[p])){
+        p++;
+    }
+
+    if (p < len && (text[p] == '#' || text[p] == 'x')){
+        hdr->format = LOAD_RLE;
+        //comment lines, then the x = w, y = h line
+        while (p < len && (text[p] == '#' || is_space(text[p]))){
+            if (text[p] == '#'){
+                while (p < len && text[p] != '\n'){
+                    p++;
+                }
+            }
+            p++;
+        }
+        for (eol = p; eol < len && text[eol] != '\n'; eol++){
+        }
+        if (!rle_field(text, &p, eol, "x", &v[0]) ||
+                !rle_field(text, &p, eol, "y", &v[1]) ||
+                v[0] < 1 || v[1] < 1 || v[0] > (1L << 30) ||
+                v[1] > (1L << 30)){
+            return -1;
+        }
+        hdr->width = (int)v[0];
+        hdr->height = (int)v[1];
+        //the rule is optional
+        while (p < eol && (is_space(text[p]) || text[p] == ',')){
+            p++;
+        }
+        if (eol - p > 4 && strncmp(text + p, "rule", 4) == 0){
+            p += 4;
+            while (p < eol && (text[p] == ' ' || text[p] == '=')){
+                p++;
+            }
+            for (int i = 0; p < eol && !is_space(text[p]) &&
+                    i < (int)sizeof(hdr->rule)-1; i++){
+                hdr->rule[i] = text[p++];
+            }
+        }
+        hdr->body = eol;
+        return 0;
+    }
+
+    hdr->format = LOAD_CELLS;
+    for (int i = 0; i < 4; i++){
+        if (scan_int(text, &p, len, &v[i]) != 1){
+            return -1;
+        }
+    }
+    if (v[0] < 1 || v[1] < 1 || v[2] < 0 || v[3] < 0 ||
+            v[0] > (1L << 30) || v[1] > (1L << 30) || v[2] > (1L << 30)){
+        return -1;
+    }
+    hdr->rows = (int)v[0];
+    hdr->cols = (int)v[1];
+    hdr->iters = (int)v[2];
+    hdr->count = v[3];
+    hdr->body = p;
+    return 0;
+}
+
+void load_cells(const char *text, size_t len, const struct load_header *hdr,
+        const char *path, uint64_t *board, size_t stride, int rows,
+        int cols, int top, int left, struct pool *pool, int threads){
+    struct chunk *chunks;
+    size_t body = hdr->body, cut;
+    long numbers = 0, x = 0, y = 0;
+    int n, skip = 0;
+
+    //small files are read by one thread, and so is any file with no pool
+    threads = pool ? threads : 1;
+    n = (int)((len - body)/MIN_CHUNK) + 1;
+    n = (n > threads) ? threads : n;
+    n = (n < 1) ? 1 : n;
+    chunks = calloc(threads, sizeof(struct chunk));
+    if (!chunks){
+        perror("calloc: chunks");
+        exit(1);
+    }
+
+    for (int i = 0; i < n; i++){
+        //move each cut forward to the start of the next word, or past
+        //the end of the RLE run it falls in
+        cut = body + (len - body)/n*i;
+        cut = (i > 0 && cut < chunks[i-1].begin) ? chunks[i-1].begin : cut;
+        while (i > 0 && cut < len && (hdr->format == LOAD_RLE ?
+                    is_digit(text[cut-1]) || is_space(text[cut-1]) :
+                    !is_space(text[cut-1]))){
+            cut++;
+        }
+        chunks[i].begin = cut;
+        if (i > 0){
+            chunks[i-1].end = cut;
+        }
+        chunks[i].text = text;
+        chunks[i].len = len;
+        chunks[i].hdr = hdr;
+        chunks[i].board = board;
+        chunks[i].stride = stride;
+        chunks[i].rows = rows;
+        chunks[i].cols = cols;
+        chunks[i].top = top;
+        chunks[i].left = left;
+    }
+    chunks[n-1].end = len;
+
+    run_chunks(pool, chunks, threads, n, hdr->format == LOAD_RLE ?
+            measure_rle : count_numbers);
+
+    //where each chunk starts
+    for (int i = 0; i < n; i++){
+        chunks[i].first = numbers;
+        numbers += chunks[i].numbers;
+        chunks[i].x = x;
+        chunks[i].y = y;
+        chunks[i].skip = skip;
+        if (!skip){
+            y += chunks[i].dy;
+            x = chunks[i].newline ? chunks[i].dx : x + chunks[i].dx;
+            skip = chunks[i].ended;
+        }
+    }
+    if (hdr->format == LOAD_CELLS && numbers < 2*hdr->count){
+        printf("Error: Missing input %s\n", path);
+        exit(1);
+    }
+
+    run_chunks(pool, chunks, threads, n, hdr->format == LOAD_RLE ?
+            parse_rle : parse_numbers);
+
+    for (int i = 0; i < n; i++){
+        if (chunks[i].error == ERR_FORMAT){
+            printf("Improper file format: %s\n", path);
+            exit(1);
+        }
+        if (chunks[i].error == ERR_OFF){
+            printf("Error: coordinate (%ld, %ld) is off the board in %s\n",
+                    chunks[i].bad_r, chunks[i].bad_c, path);
+            exit(1);
+        }
+    }
+    free(chunks);
+}
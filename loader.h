@@ -0,0 +1,58 @@
+#ifndef __LOADER_H__
+#define __LOADER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pool.h"
+
+/* This file declares the input file loader. It reads two formats:
+ *   - the program's own: rows, cols, rounds and the number of live cells,
+ *     then that many "row col" pairs, all separated by whitespace
+ *   - RLE, the run length encoded pattern format most published patterns
+ *     come in: '#' comment lines, a "x = w, y = h, rule = B3/S23" line,
+ *     then runs of dead (b) and live (o) cells, with $ ending a row and !
+ *     ending the pattern
+ * The file is memory mapped and split into one chunk per thread, and the
+ * chunks are parsed in parallel, straight into the board, on the worker
+ * pool that plays the game (pool.h), so loading a file starts no threads
+ * of its own. */
+
+#define LOAD_CELLS  (0)   // the program's own coordinate list
+#define LOAD_RLE    (1)   // RLE pattern
+
+struct load_header {
+    int format;     // LOAD_CELLS or LOAD_RLE
+    int rows;       // board size and rounds (LOAD_CELLS only)
+    int cols;
+    int iters;
+    long count;     // number of coordinate pairs (LOAD_CELLS only)
+    int width;      // pattern size (LOAD_RLE only)
+    int height;
+    char rule[32];  // rule from the RLE header, "" if there was none
+    size_t body;    // offset of the cells in the file
+};
+
+/* Maps the file at path into memory, read only.
+ * param len: set to the file's length
+ * returns the file's text (not 0 terminated), or exits on an error */
+const char *load_map(const char *path, size_t *len);
+void load_unmap(const char *text, size_t len);
+
+/* Reads the header of a mapped input file into hdr, and works out which
+ * of the two formats it is in.
+ * returns 0, or -1 if the header is not in either format */
+int load_header(const char *text, size_t len, struct load_header *hdr);
+
+/* Sets the live cells listed in the body of the file on the board, using
+ * the threads workers of pool; with no pool (NULL, as when the caller is
+ * one of the pool's workers itself) the calling thread does it all. The
+ * board's row r starts at board + r*stride, cell c is bit c%64 of word
+ * c/64 of its row, and it must start out all dead.
+ * An RLE pattern is placed with its top left corner at (top, left).
+ * Prints an error naming path and exits if the body is cut short, has a
+ * bad character in it, or puts a cell off the board. */
+void load_cells(const char *text, size_t len, const struct load_header *hdr,
+        const char *path, uint64_t *board, size_t stride, int rows,
+        int cols, int top, int left, struct pool *pool, int threads);
+
+#endif  /* __LOADER_H__ */
@@ -0,0 +1,36 @@
+#ifndef __NOVISI_H__
+#define __NOVISI_H__
+
+#include <stddef.h>
+
+/* This file stands in for ParaVisi's pthreadGridVisi.h when the program
+ * is built without ParaVisi and Qt (make NOVISI=1, which defines
+ * GOL_NO_VISI), for machines with no display. It has the types that
+ * struct gol_data and colors.h use, and ParaVisi's functions as stubs
+ * that are never called: output mode 2 is refused in such a build, and
+ * output mode 3 writes frames to look at instead (see frames.h). */
+
+typedef struct {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+} color3;
+
+typedef void *visi_handle;
+
+static inline visi_handle init_pthread_animation(int num_tids, int rows,
+        int cols, char *name){
+    return NULL;
+}
+
+static inline color3 *get_animation_buffer(visi_handle handle){
+    return NULL;
+}
+
+static inline void run_animation(visi_handle handle, int iters){
+}
+
+static inline void draw_ready(visi_handle handle){
+}
+
+#endif  /* __NOVISI_H__ */
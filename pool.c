@@ -0,0 +1,294 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the worker pool and the round barrier.
+ *
+ * The workers are created once and sleep on a condition variable between
+ * games, so a run over several input files pays for thread creation only
+ * once. Starting a game and waiting for it are rare, so they just use a
+ * mutex and condition variables. Workers can be pinned to a CPU each, so
+ * that memory they touch first stays on their NUMA node and they stay
+ * next to it.
+ *
+ * The barrier is hit every round, so it avoids the kernel when it can.
+ * Each thread notes the barrier's sense when it arrives (the sense can't
+ * flip before every thread is there), and the last thread to arrive
+ * flips it. The others watch for the flip, first by spinning and, once
+ * their spin budget is used up, asleep on a futex on the sense word. The
+ * last thread only makes the wake up system call when somebody went to
+ * sleep.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "pool.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+struct pool_worker {
+    struct pool *pool;
+    int id;
+    int cpu;    // CPU to pin the worker to, or -1
+};
+
+struct pool {
+    int threads;
+    pthread_t *tid;
+    struct pool_worker *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t start;   // workers wait here for a job
+    pthread_cond_t finish;  // pool_wait waits here for the workers
+    unsigned long job;      // counts the jobs started
+    int running;            // workers still busy with the current job
+    int quit;
+    void *(*fn)(void *);
+    char *args;
+    size_t size;
+};
+
+/* This function tells the CPU that the thread is spinning, so it can
+ * give the core's resources to the other hyperthread for a moment. */
+static inline void cpu_relax(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* This function sleeps until *word is no longer val (or returns right
+ * away if it already isn't). It may also return early for no reason, so
+ * callers check again. */
+static void park(int *word, int val){
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+    (void)word;
+    (void)val;
+    sched_yield();
+#endif
+}
+
+/* This function wakes every thread parked on word. */
+static void unpark_all(int *word){
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+/* This function sets up a barrier.
+ * param count: number of threads that meet at the barrier
+ * param spin: times a thread checks the barrier before sleeping, or -1
+ *        to pick: spinning only pays off when every thread has a CPU of
+ *        its own, otherwise the spinner holds up the very thread it is
+ *        waiting for */
+void pool_barrier_init(struct pool_barrier *b, int count, int spin){
+    if (spin < 0){
+        spin = (count <= sysconf(_SC_NPROCESSORS_ONLN)) ?
+            POOL_SPIN_DEFAULT : 0;
+    }
+    b->count = count;
+    b->spin = spin;
+    b->waiting = 0;
+    b->sense = 0;
+    b->sleepers = 0;
+}
+
+/* This function waits at the barrier until all threads have arrived.
+ * returns 1 in the last thread to arrive, 0 in the others */
+int pool_barrier_wait(struct pool_barrier *b){
+    int sense = !__atomic_load_n(&b->sense, __ATOMIC_ACQUIRE);
+
+    if (__atomic_add_fetch(&b->waiting, 1, __ATOMIC_ACQ_REL) == b->count){
+        //nobody touches waiting again until they see the flip
+        __atomic_store_n(&b->waiting, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&b->sense, sense, __ATOMIC_SEQ_CST);
+        //a sleeper counts itself before its last look at the sense, so
+        //either it sees the flip or this sees it
+        if (__atomic_load_n(&b->sleepers, __ATOMIC_SEQ_CST) > 0){
+            unpark_all(&b->sense);
+        }
+        return 1;
+    }
+
+    for (int i = 0; i < b->spin; i++){
+        if (__atomic_load_n(&b->sense, __ATOMIC_ACQUIRE) == sense){
+            return 0;
+        }
+        cpu_relax();
+    }
+
+    __atomic_add_fetch(&b->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&b->sense, __ATOMIC_SEQ_CST) != sense){
+        //the futex only sleeps while the sense is still the old one
+        park(&b->sense, !sense);
+    }
+    __atomic_sub_fetch(&b->sleepers, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+/* This function is the loop each worker thread runs: wait for a job,
+ * run its part of it, and report back, until the pool is destroyed. */
+static void *pool_worker_loop(void *args){
+    struct pool_worker *w = (struct pool_worker *)args;
+    struct pool *p = w->pool;
+    unsigned long seen = 0;
+    void *(*fn)(void *);
+    void *arg;
+
+    if (w->cpu >= 0){
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0){
+            perror("pthread_setaffinity_np");
+            exit(1);
+        }
+    }
+
+    pthread_mutex_lock(&p->lock);
+    for (;;){
+        while (p->job == seen && !p->quit){
+            pthread_cond_wait(&p->start, &p->lock);
+        }
+        if (p->quit){
+            break;
+        }
+        seen = p->job;
+        fn = p->fn;
+        arg = p->args + w->id*p->size;
+        pthread_mutex_unlock(&p->lock);
+
+        fn(arg);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->running == 0){
+            pthread_cond_signal(&p->finish);
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/* This function starts the worker threads.
+ * param threads: number of workers
+ * param pin: 1 to pin each worker to a CPU of its own
+ * returns the pool */
+struct pool *pool_create(int threads, int pin){
+    struct pool *p = calloc(1, sizeof(struct pool));
+    cpu_set_t allowed;
+    int cpu = -1;
+
+    if (!p){
+        perror("calloc: pool");
+        exit(1);
+    }
+    p->threads = threads;
+    p->tid = malloc(sizeof(pthread_t)*threads);
+    p->workers = malloc(sizeof(struct pool_worker)*threads);
+    if (!p->tid || !p->workers){
+        perror("malloc: pool threads");
+        exit(1);
+    }
+    if (pthread_mutex_init(&p->lock, NULL) != 0 ||
+            pthread_cond_init(&p->start, NULL) != 0 ||
+            pthread_cond_init(&p->finish, NULL) != 0){
+        perror("pool_create");
+        exit(1);
+    }
+
+    //hand out the CPUs we may use in order, so threads next to each
+    //other on the board (and in number) share a node
+    if (pin && sched_getaffinity(0, sizeof(allowed), &allowed) != 0){
+        perror("sched_getaffinity");
+        exit(1);
+    }
+    for (int i = 0; i < threads; i++){
+        p->workers[i].pool = p;
+        p->workers[i].id = i;
+        p->workers[i].cpu = -1;
+        if (pin){
+            do {
+                cpu = (cpu + 1) % CPU_SETSIZE;
+            } while (!CPU_ISSET(cpu, &allowed));
+            p->workers[i].cpu = cpu;
+        }
+        if (pthread_create(&p->tid[i], NULL, pool_worker_loop,
+                    &p->workers[i]) != 0){
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    return p;
+}
+
+/* This function finds out where the calling thread is running.
+ * param cpu: set to the CPU, or -1
+ * param node: set to the CPU's NUMA node, or -1 */
+void pool_where(int *cpu, int *node){
+    *cpu = -1;
+    *node = -1;
+#ifdef __linux__
+    unsigned c, n;
+
+    if (syscall(SYS_getcpu, &c, &n, NULL) == 0){
+        *cpu = (int)c;
+        *node = (int)n;
+    }
+#endif
+}
+
+/* This function hands a job to the workers: worker i runs
+ * fn(args + i*size). It returns without waiting for them.
+ * param args: array of one argument per worker
+ * param size: size of each argument in bytes */
+void pool_start(struct pool *p, void *(*fn)(void *), void *args,
+        size_t size){
+    pthread_mutex_lock(&p->lock);
+    p->fn = fn;
+    p->args = (char *)args;
+    p->size = size;
+    p->running = p->threads;
+    p->job++;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+}
+
+/* This function waits for every worker to finish the job from the last
+ * pool_start. */
+void pool_wait(struct pool *p){
+    pthread_mutex_lock(&p->lock);
+    while (p->running > 0){
+        pthread_cond_wait(&p->finish, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+/* This function stops and joins the workers and frees the pool. */
+void pool_destroy(struct pool *p){
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->threads; i++){
+        pthread_join(p->tid[i], NULL);
+    }
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->start);
+    pthread_cond_destroy(&p->finish);
+    free(p->tid);
+    free(p->workers);
+    free(p);
+}
@@ -0,0 +1,57 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* This file declares a pool of worker threads that is started once and
+ * reused for every game the program plays, and the barrier the workers
+ * use between rounds. */
+
+/* How many times a thread checks the barrier before it gives up and
+ * sleeps, when every thread has a CPU to itself. A round on a small
+ * board takes microseconds, so a waiting thread usually sees the others
+ * arrive well before this runs out. */
+#define POOL_SPIN_DEFAULT  (4096)
+
+/* A sense-reversing barrier for a fixed number of threads. Threads that
+ * arrive early spin for a while before going to sleep, so a short wait
+ * never goes through the kernel. */
+struct pool_barrier {
+    int count;      // number of threads that meet at the barrier
+    int spin;       // times to check before going to sleep
+    int waiting;    // threads that have arrived this time
+    int sense;      // flips each time every thread has arrived
+    int sleepers;   // threads asleep on the sense
+} __attribute__((aligned(64)));
+
+/* Sets up a barrier for count threads that spin spin times before
+ * sleeping (0 sleeps right away, -1 picks POOL_SPIN_DEFAULT if there is
+ * a CPU for every thread and 0 if not). */
+void pool_barrier_init(struct pool_barrier *b, int count, int spin);
+
+/* Waits until all count threads have called this.
+ * returns 1 in the last thread to arrive, 0 in the others */
+int pool_barrier_wait(struct pool_barrier *b);
+
+struct pool;
+
+/* Starts threads worker threads, which wait for pool_start. If pin is
+ * set, worker i is pinned to the i-th CPU this process may run on (going
+ * around again if there are more workers than CPUs). */
+struct pool *pool_create(int threads, int pin);
+
+/* Sets cpu and node to the CPU the calling thread is running on and its
+ * NUMA node (-1 if they can't be found out). */
+void pool_where(int *cpu, int *node);
+
+/* Has worker i run fn(args + i*size), for every worker, and returns
+ * right away; pool_wait waits for all of them to return. */
+void pool_start(struct pool *p, void *(*fn)(void *), void *args,
+        size_t size);
+void pool_wait(struct pool *p);
+
+/* Stops the workers and frees the pool. */
+void pool_destroy(struct pool *p);
+
+#endif  /* __POOL_H__ */
@@ -0,0 +1,211 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the renderer (see render.h).
+ *
+ * The three frames trade places through one word, ready, which holds
+ * the index of the newest published frame and a FRESH bit that says the
+ * renderer hasn't taken it yet. The publisher writes into its own frame
+ * (back), then swaps it into ready and takes whatever was there as its
+ * next back frame; the renderer swaps its own frame (front) into ready
+ * to take the newest one. Each side only ever touches the frame it owns,
+ * so a frame is never written while it is being drawn.
+ *
+ * Copying the board costs the publisher a pass over it, so the renderer
+ * sets want when it is ready for a frame and the publisher skips every
+ * round in between; at 10 frames a second almost every round is skipped.
+ * The mutex and condition variable are only for the renderer to sleep
+ * on while it waits for a frame it asked for.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "render.h"
+
+/* Set in ready when the renderer hasn't taken the frame there yet */
+#define FRESH  (4)
+
+struct renderer {
+    struct grid grid;
+    struct frame frames[3];
+    int back;           // the publisher's frame
+    int front;          // the renderer's frame
+    int ready;          // the newest frame, and FRESH
+    int want;           // the renderer is waiting for a frame
+    long period;        // nanoseconds between frames, 0 for no limit
+    render_fn draw;
+    void *arg;
+    int drawn;          // frames drawn
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;    // the renderer waits here for a frame
+};
+
+/* This function waits until the time in *next, then moves it on by
+ * period nanoseconds; if the last frame took longer than that, the next
+ * one is due right away rather than in a rush to catch up. */
+static void wait_period(struct timespec *next, long period){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    next->tv_nsec += period;
+    next->tv_sec += next->tv_nsec/1000000000L;
+    next->tv_nsec %= 1000000000L;
+    if (now.tv_sec > next->tv_sec || (now.tv_sec == next->tv_sec &&
+                now.tv_nsec >= next->tv_nsec)){
+        *next = now;
+        return;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, next, NULL) ==
+            EINTR){
+    }
+}
+
+/* This function is the renderer thread: it asks for a frame, draws it
+ * once it comes, waits out the rest of the frame's time, and goes again
+ * until it has drawn the final board.
+ * param args: the struct renderer
+ */
+static void *render_loop(void *args){
+    struct renderer *r = (struct renderer *)args;
+    struct frame *frame;
+    struct timespec next;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (;;){
+        //the first board is published without being asked for
+        pthread_mutex_lock(&r->lock);
+        if (!(__atomic_load_n(&r->ready, __ATOMIC_ACQUIRE) & FRESH)){
+            __atomic_store_n(&r->want, 1, __ATOMIC_RELEASE);
+        }
+        while (!(__atomic_load_n(&r->ready, __ATOMIC_ACQUIRE) & FRESH)){
+            pthread_cond_wait(&r->wake, &r->lock);
+        }
+        pthread_mutex_unlock(&r->lock);
+
+        r->front = __atomic_exchange_n(&r->ready, r->front,
+                __ATOMIC_ACQ_REL) & ~FRESH;
+        frame = &r->frames[r->front];
+        r->draw(r->arg, frame);
+        r->drawn++;
+        if (frame->last){
+            return NULL;
+        }
+        if (r->period > 0){
+            wait_period(&next, r->period);
+        }
+    }
+}
+
+/* This function starts a renderer.
+ * param g: the layout of the boards it will be handed
+ * param fps: most frames to draw a second, 0 for no limit
+ * param draw: draws a frame
+ * param arg: passed on to draw
+ * returns the renderer
+ */
+struct renderer *render_start(const struct grid *g, double fps,
+        render_fn draw, void *arg){
+    struct renderer *r = calloc(1, sizeof(struct renderer));
+
+    if (!r){
+        perror("calloc: renderer");
+        exit(1);
+    }
+    r->grid = *g;
+    for (int i = 0; i < 3; i++){
+        r->frames[i].cells = malloc(grid_bytes(g));
+        if (!r->frames[i].cells){
+            perror("malloc: frame");
+            exit(1);
+        }
+    }
+    r->back = 0;
+    r->ready = 1;
+    r->front = 2;
+    r->want = 1;    // the board before the first round is always drawn
+    r->period = (fps > 0) ? (long)(1e9/fps) : 0;
+    r->draw = draw;
+    r->arg = arg;
+    if (pthread_mutex_init(&r->lock, NULL) != 0 ||
+            pthread_cond_init(&r->wake, NULL) != 0){
+        perror("render_start");
+        exit(1);
+    }
+    if (pthread_create(&r->tid, NULL, render_loop, r) != 0){
+        perror("pthread_create: renderer");
+        exit(1);
+    }
+    return r;
+}
+
+/* This function copies a board into the publisher's frame and swaps it
+ * in as the newest one, waking the renderer.
+ * param r: the renderer
+ * param cells: the board
+ * param round, live, last: as for struct frame
+ */
+static void publish(struct renderer *r, uint64_t *cells, int round,
+        int live, int last){
+    struct frame *frame = &r->frames[r->back];
+
+    __atomic_store_n(&r->want, 0, __ATOMIC_RELAXED);
+    memcpy(frame->cells, cells, grid_bytes(&r->grid));
+    frame->round = round;
+    frame->live = live;
+    frame->last = last;
+    r->back = __atomic_exchange_n(&r->ready, r->back | FRESH,
+            __ATOMIC_ACQ_REL) & ~FRESH;
+
+    pthread_mutex_lock(&r->lock);
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+}
+
+/* This function publishes a board if the renderer wants a frame.
+ * param r: the renderer
+ * param cells: the board
+ * param round: rounds played
+ * param live: live cells on the board
+ */
+void render_publish(struct renderer *r, uint64_t *cells, int round,
+        int live){
+    if (__atomic_load_n(&r->want, __ATOMIC_ACQUIRE)){
+        publish(r, cells, round, live, 0);
+    }
+}
+
+/* This function publishes the final board.
+ * param r: the renderer
+ * param cells: the board
+ * param round: rounds played
+ * param live: live cells on the board
+ */
+void render_last(struct renderer *r, uint64_t *cells, int round, int live){
+    publish(r, cells, round, live, 1);
+}
+
+/* This function waits for the renderer to draw the final board and
+ * frees it.
+ * param r: the renderer
+ * returns the number of frames it drew
+ */
+int render_stop(struct renderer *r){
+    int drawn;
+
+    pthread_join(r->tid, NULL);
+    drawn = r->drawn;
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->wake);
+    for (int i = 0; i < 3; i++){
+        free(r->frames[i].cells);
+    }
+    free(r);
+    return drawn;
+}
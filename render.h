@@ -0,0 +1,45 @@
+#ifndef __RENDER_H__
+#define __RENDER_H__
+
+#include <stdint.h>
+#include "grid.h"
+
+/* This file declares the renderer: a thread of its own that draws the
+ * board while the game plays on at full speed. The game publishes
+ * frames (copies of the board) into a triple buffer, one for the frame
+ * being drawn, one for the newest frame waiting to be drawn and one being
+ * written, so neither side ever waits for the other. The renderer draws
+ * at most fps frames a second, and asks for a frame only when it is
+ * ready to draw one; rounds played in between are never copied at all. */
+
+/* A board as it was after some round */
+struct frame {
+    uint64_t *cells;    // the board, laid out as in grid.h, ghosts and all
+    int round;          // rounds played
+    int live;           // live cells
+    int last;           // the game is over, this is the final board
+};
+
+/* Draws a frame; arg is whatever was passed to render_start */
+typedef void (*render_fn)(void *arg, const struct frame *frame);
+
+struct renderer;
+
+/* Starts a renderer thread for boards laid out as g, which draws with
+ * draw at most fps frames a second (0 for as fast as it can). */
+struct renderer *render_start(const struct grid *g, double fps,
+        render_fn draw, void *arg);
+
+/* Hands the renderer the board after a round, if it is waiting for a
+ * frame; otherwise it returns right away. Only one thread may publish. */
+void render_publish(struct renderer *r, uint64_t *cells, int round,
+        int live);
+
+/* Hands the renderer the final board, which it always draws. */
+void render_last(struct renderer *r, uint64_t *cells, int round, int live);
+
+/* Waits for the renderer to draw the final board, then stops it.
+ * returns the number of frames it drew */
+int render_stop(struct renderer *r);
+
+#endif  /* __RENDER_H__ */
@@ -0,0 +1,181 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements reading and writing snapshots (see snapshot.h).
+ * Loading is a single mmap of the board, so a snapshot of any size
+ * loads in about the time it takes to check its header; the pages are
+ * read in as the first round touches them.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+/* This function returns the size in bytes of the board in a snapshot. */
+static size_t board_bytes(const struct snapshot_header *hdr){
+    return (size_t)(hdr->rows+2)*hdr->stride*sizeof(uint64_t);
+}
+
+/* This function reads the header of a snapshot.
+ * param fd: the open file
+ * param hdr: set to the header
+ * returns 1 if there was a whole header with the right magic number, -1
+ *         if the magic number is there but byte-swapped (a snapshot from
+ *         a machine of the other byte order), 0 otherwise */
+static int read_header(int fd, struct snapshot_header *hdr){
+    if (pread(fd, hdr, sizeof(*hdr), 0) != (ssize_t)sizeof(*hdr)){
+        return 0;
+    }
+    if (hdr->magic == __builtin_bswap64(SNAPSHOT_MAGIC)){
+        return -1;
+    }
+    return hdr->magic == SNAPSHOT_MAGIC;
+}
+
+int snapshot_is(const char *path){
+    struct snapshot_header hdr;
+    int fd = open(path, O_RDONLY);
+    int ret;
+
+    if (fd < 0){
+        return 0;
+    }
+    //a snapshot of the wrong byte order is still a snapshot, so that
+    //snapshot_map can say what is wrong with it
+    ret = read_header(fd, &hdr) != 0;
+    close(fd);
+    return ret;
+}
+
+uint64_t *snapshot_map(const char *path, struct snapshot_header *hdr){
+    struct stat st;
+    void *board;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0){
+        perror(path);
+        exit(1);
+    }
+    switch (read_header(fd, hdr)){
+        case -1:
+            printf("Error: %s is a snapshot from a machine of the other"
+                    " byte order, which this program can't read\n", path);
+            exit(1);
+        case 0:
+            printf("Error: %s is not a snapshot\n", path);
+            exit(1);
+    }
+    if (fstat(fd, &st) != 0){
+        perror(path);
+        exit(1);
+    }
+    if (hdr->version != SNAPSHOT_VERSION ||
+            hdr->header_size != SNAPSHOT_HEADER){
+        printf("Error: %s is a snapshot of version %u, this program reads "
+                "version %d\n", path, hdr->version, SNAPSHOT_VERSION);
+        exit(1);
+    }
+    //the board has to be laid out the way the program lays it out
+    if (hdr->rows < 1 || hdr->cols < 1 ||
+            hdr->words != (hdr->cols + 63)/64 ||
+            hdr->stride != hdr->words + 2 ||
+            hdr->generation < 0 || hdr->generation > hdr->iters ||
+            (size_t)st.st_size < SNAPSHOT_HEADER + board_bytes(hdr)){
+        printf("Error: snapshot %s is damaged or cut short\n", path);
+        exit(1);
+    }
+
+    board = mmap(NULL, board_bytes(hdr), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE, fd, SNAPSHOT_HEADER);
+    if (board == MAP_FAILED){
+        perror("mmap: snapshot");
+        exit(1);
+    }
+    close(fd);
+    return board;
+}
+
+/* This function makes a rename in the directory path is in stick, by
+ * syncing the directory. Some file systems can't sync a directory
+ * (EINVAL); there, the rename is as safe as they make it.
+ * param path: a file in the directory */
+static void sync_dir(const char *path){
+    char *dir = strdup(path);
+    char *slash;
+    int fd;
+
+    if (!dir){
+        perror("strdup: snapshot path");
+        exit(1);
+    }
+    slash = strrchr(dir, '/');
+    if (slash == NULL){
+        strcpy(dir, ".");
+    } else {
+        slash[slash == dir ? 1 : 0] = '\0';
+    }
+    fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0 || (fsync(fd) != 0 && errno != EINVAL)){
+        perror(dir);
+        exit(1);
+    }
+    close(fd);
+    free(dir);
+}
+
+void snapshot_write(const char *path, const struct snapshot_header *hdr,
+        const uint64_t *board){
+    char page[SNAPSHOT_HEADER] = {0};
+    char *tmp = malloc(strlen(path) + 5);
+    const char *buf;
+    size_t left;
+    ssize_t n;
+    int fd;
+
+    if (!tmp){
+        perror("malloc: snapshot path");
+        exit(1);
+    }
+    sprintf(tmp, "%s.tmp", path);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0){
+        perror(tmp);
+        exit(1);
+    }
+
+    memcpy(page, hdr, sizeof(*hdr));
+    for (int part = 0; part < 2; part++){
+        buf = part == 0 ? page : (const char *)board;
+        left = part == 0 ? sizeof(page) : board_bytes(hdr);
+        while (left > 0){
+            n = write(fd, buf, left);
+            if (n < 0){
+                perror("write: snapshot");
+                exit(1);
+            }
+            buf += n;
+            left -= n;
+        }
+    }
+
+    //the board has to be on the disk before the rename is, or a power
+    //cut could leave the new name on a file that never got its data
+    if (fsync(fd) != 0){
+        perror("fsync: snapshot");
+        exit(1);
+    }
+    if (close(fd) != 0 || rename(tmp, path) != 0){
+        perror(path);
+        exit(1);
+    }
+    sync_dir(path);
+    free(tmp);
+}
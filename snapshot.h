@@ -0,0 +1,54 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* This file declares the binary snapshot format: a saved game that can
+ * be loaded straight into memory instead of being parsed.
+ *
+ * A snapshot is one page of header followed by the board exactly as the
+ * program keeps it in memory: rows+2 rows (with the ghost rows) of
+ * stride words, cell c of a row in bit c%64 of word c/64. Since the
+ * board starts on a page boundary it can be mmapped and used as is.
+ * Numbers are stored in the byte order of the machine that wrote them;
+ * the magic number tells when that isn't this machine's, and such a
+ * snapshot is refused with an error saying so. */
+
+#define SNAPSHOT_MAGIC    (0x31504e534c4f47ULL)  // "GOLSNP1" read as a word
+#define SNAPSHOT_VERSION  (2)
+#define SNAPSHOT_HEADER   (4096)                 // bytes before the board
+
+struct snapshot_header {
+    uint64_t magic;       // SNAPSHOT_MAGIC
+    uint32_t version;     // SNAPSHOT_VERSION
+    uint32_t header_size; // SNAPSHOT_HEADER
+    int32_t rows;
+    int32_t cols;
+    int32_t words;        // 64-bit words of cells in a row
+    int32_t stride;       // words from one row to the next (words+2)
+    int64_t iters;        // rounds the game is to be played for in all
+    int64_t generation;   // rounds already played
+    int64_t live;         // live cells on the board
+    uint16_t birth;       // the rule the game is played by, as in
+    uint16_t survive;     // struct rule (see kernel.h)
+};
+
+/* returns 1 if the file at path starts with a snapshot header, of either
+ * byte order */
+int snapshot_is(const char *path);
+
+/* Maps the board of the snapshot at path into memory, copy-on-write, so
+ * changes to it never reach the file, and fills in hdr. Exits with an
+ * error message if the file isn't a snapshot this program can read.
+ * returns the board, (hdr->rows+2)*hdr->stride words, to munmap */
+uint64_t *snapshot_map(const char *path, struct snapshot_header *hdr);
+
+/* Writes hdr and the board to path, through a temporary file that is
+ * synced to the disk and then renamed over path, and syncs the directory
+ * after, so neither a crash nor a power cut leaves half a snapshot where
+ * the last good one was. */
+void snapshot_write(const char *path, const struct snapshot_header *hdr,
+        const uint64_t *board);
+
+#endif  /* __SNAPSHOT_H__ */
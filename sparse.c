@@ -0,0 +1,407 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the sparse engine (see sparse.h).
+ *
+ * The board is cut into chunks of 64 rows of one 64-bit word each, so a
+ * chunk lines up with the words of the packed board: chunk (cr, cc)
+ * holds rows 64*cr.. of word cc. Only chunks with live cells are kept,
+ * in an open-addressing hash table keyed on their chunk coordinates.
+ *
+ * A cell can only come alive next to a live cell, so the chunks that can
+ * have live cells next round are the live chunks and the neighbours of
+ * the ones with live cells on the edge or corner they share. Each round
+ * those candidates are put in a second table and computed there, with
+ * the same row kernel the dense engine uses: every row of a chunk is
+ * given to the kernel as a one-word row with its ghost words, read from
+ * the chunks to its left and right (and the rows above and below from
+ * the chunks above and below). Candidates that came out empty are then
+ * dropped, and the second table becomes the board.
+ *
+ * The last chunk row and column can be cut short by the edge of the
+ * board; cells past the edge are kept 0, and reading across the edge
+ * wraps around to the other side of the board, as the dense board's
+ * ghost cells do.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "sparse.h"
+
+/* Slots a table starts with (a power of 2) */
+#define FIRST_SLOTS   (1 << 10)
+
+struct chunk {
+    int cr, cc;                     // chunk row and column
+    uint64_t rows[SPARSE_CHUNK];    // one word of each row
+};
+
+/* A table of chunks. The chunks are packed in an array, in the order
+ * they were added; the hash slots hold an index into it, plus 1 (0 is an
+ * empty slot). */
+struct table {
+    struct chunk *chunks;
+    int count;      // chunks in use
+    int size;       // chunks allocated
+    int *slots;
+    int mask;       // number of slots - 1
+};
+
+struct sparse {
+    int rows, cols;
+    int chunk_rows, chunk_cols;     // size of the board in chunks
+    row_kernel_fn row;
+    struct table now, next;         // this round's board, and the next
+    long live;
+
+    // the last chunk looked up in now, to skip the hash on most reads
+    int last_cr, last_cc;
+    const struct chunk *last;
+};
+
+/* This function mixes chunk coordinates into a hash (splitmix64's
+ * finalizer). */
+static inline uint64_t chunk_hash(int cr, int cc){
+    uint64_t x = ((uint64_t)(uint32_t)cr << 32) | (uint32_t)cc;
+
+    x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static void table_init(struct table *t){
+    t->count = 0;
+    t->size = FIRST_SLOTS/2;
+    t->mask = FIRST_SLOTS - 1;
+    t->chunks = malloc(sizeof(struct chunk)*t->size);
+    t->slots = calloc(FIRST_SLOTS, sizeof(int));
+    if (!t->chunks || !t->slots){
+        perror("malloc: sparse table");
+        exit(1);
+    }
+}
+
+/* This function empties a table, keeping its memory. */
+static void table_clear(struct table *t){
+    memset(t->slots, 0, sizeof(int)*(t->mask + 1));
+    t->count = 0;
+}
+
+/* This function finds the slot for chunk (cr, cc): the one holding it,
+ * or the empty slot it would go in. */
+static int *table_slot(const struct table *t, int cr, int cc){
+    size_t i = chunk_hash(cr, cc) & t->mask;
+    const struct chunk *c;
+
+    while (t->slots[i]){
+        c = &t->chunks[t->slots[i] - 1];
+        if (c->cr == cr && c->cc == cc){
+            break;
+        }
+        i = (i + 1) & t->mask;
+    }
+    return &t->slots[i];
+}
+
+/* This function looks up chunk (cr, cc).
+ * returns the chunk, or NULL if it isn't in the table */
+static const struct chunk *table_find(const struct table *t, int cr,
+        int cc){
+    int *slot = table_slot(t, cr, cc);
+
+    return *slot ? &t->chunks[*slot - 1] : NULL;
+}
+
+/* This function doubles the slots of a table and puts every chunk back
+ * in them. */
+static void table_grow(struct table *t){
+    int slots = 2*(t->mask + 1);
+
+    free(t->slots);
+    t->slots = calloc(slots, sizeof(int));
+    if (!t->slots){
+        perror("calloc: sparse table");
+        exit(1);
+    }
+    t->mask = slots - 1;
+    for (int i = 0; i < t->count; i++){
+        *table_slot(t, t->chunks[i].cr, t->chunks[i].cc) = i + 1;
+    }
+}
+
+/* This function adds chunk (cr, cc) to a table, all dead, unless it is
+ * there already. Adding can move the chunks, so it returns an index.
+ * returns the chunk's index in t->chunks */
+static int table_add(struct table *t, int cr, int cc){
+    int *slot = table_slot(t, cr, cc);
+
+    if (*slot){
+        return *slot - 1;
+    }
+    if (t->count == t->size){
+        t->size *= 2;
+        t->chunks = realloc(t->chunks, sizeof(struct chunk)*t->size);
+        if (!t->chunks){
+            perror("realloc: sparse table");
+            exit(1);
+        }
+    }
+    t->chunks[t->count].cr = cr;
+    t->chunks[t->count].cc = cc;
+    memset(t->chunks[t->count].rows, 0, sizeof(t->chunks[0].rows));
+    *slot = ++t->count;
+    //keep the slots at most half full
+    if (2*t->count > t->mask + 1){
+        table_grow(t);
+    }
+    return t->count - 1;
+}
+
+struct sparse *sparse_create(int rows, int cols, row_kernel_fn row){
+    struct sparse *s = malloc(sizeof(struct sparse));
+
+    if (!s){
+        perror("malloc: sparse");
+        exit(1);
+    }
+    s->rows = rows;
+    s->cols = cols;
+    s->chunk_rows = (rows + SPARSE_CHUNK - 1)/SPARSE_CHUNK;
+    s->chunk_cols = (cols + SPARSE_CHUNK - 1)/SPARSE_CHUNK;
+    s->row = row;
+    s->live = 0;
+    s->last = NULL;
+    s->last_cr = s->last_cc = -1;
+    table_init(&s->now);
+    table_init(&s->next);
+    return s;
+}
+
+void sparse_free(struct sparse *s){
+    free(s->now.chunks);
+    free(s->now.slots);
+    free(s->next.chunks);
+    free(s->next.slots);
+    free(s);
+}
+
+/* This function finds the number of rows or columns of cells in the
+ * chunk at index i along a side of n cells. */
+static inline int chunk_span(int i, int n){
+    int left = n - i*SPARSE_CHUNK;
+
+    return (left < SPARSE_CHUNK) ? left : SPARSE_CHUNK;
+}
+
+void sparse_load(struct sparse *s, const uint64_t *board, size_t stride){
+    int words = s->chunk_cols;
+    const uint64_t *row;
+    int i;
+
+    for (int r = 0; r < s->rows; r++){
+        row = board + r*stride;
+        for (int k = 0; k < words; k++){
+            if (row[k]){
+                i = table_add(&s->now, r/SPARSE_CHUNK, k);
+                s->now.chunks[i].rows[r%SPARSE_CHUNK] = row[k];
+                s->live += __builtin_popcountll(row[k]);
+            }
+        }
+    }
+}
+
+void sparse_store(const struct sparse *s, uint64_t *board, size_t stride){
+    int words = s->chunk_cols;
+    const struct chunk *c;
+    uint64_t *row, word;
+
+    for (int r = 0; r < s->rows; r++){
+        row = board + r*stride;
+        for (int k = 0; k < words; k++){
+            c = table_find(&s->now, r/SPARSE_CHUNK, k);
+            word = c ? c->rows[r%SPARSE_CHUNK] : 0;
+            if (row[k] != word){
+                row[k] = word;
+            }
+        }
+    }
+}
+
+/* This function finds chunk (cr, cc) of this round's board, remembering
+ * it for the next call, which is most often for the same chunk.
+ * returns the chunk, or NULL if it is all dead */
+static inline const struct chunk *lookup(struct sparse *s, int cr, int cc){
+    if (cr != s->last_cr || cc != s->last_cc){
+        s->last = table_find(&s->now, cr, cc);
+        s->last_cr = cr;
+        s->last_cc = cc;
+    }
+    return s->last;
+}
+
+/* This function reads one word of a row of this round's board: the 64
+ * cells from column col, wrapping around at the edges (as many times as
+ * it takes, on boards narrower than 64 cells).
+ * param r: the row (rows past the edges wrap)
+ * param col: the first column (columns past the edges wrap) */
+static uint64_t read_word(struct sparse *s, int r, int col){
+    const struct chunk *c;
+    int cr, cc, shift;
+    uint64_t word = 0;
+
+    r = ((r % s->rows) + s->rows) % s->rows;
+    col = ((col % s->cols) + s->cols) % s->cols;
+    cr = r/SPARSE_CHUNK;
+
+    for (int got = 0; got < 64; ){
+        cc = col/SPARSE_CHUNK;
+        shift = col%SPARSE_CHUNK;
+        c = lookup(s, cr, cc);
+        if (c){
+            word |= (c->rows[r%SPARSE_CHUNK] >> shift) << got;
+        }
+        //the rest of the 64 cells come from the chunk(s) to the right
+        got += chunk_span(cc, s->cols) - shift;
+        col = (cc + 1 < s->chunk_cols) ? (cc + 1)*SPARSE_CHUNK : 0;
+    }
+    return word;
+}
+
+/* This function reads the cell at row r, column col of this round's
+ * board, wrapping around at the edges like read_word.
+ * returns 1 if the cell is alive, 0 if not */
+static uint64_t read_cell(struct sparse *s, int r, int col){
+    const struct chunk *c;
+
+    r = ((r % s->rows) + s->rows) % s->rows;
+    col = ((col % s->cols) + s->cols) % s->cols;
+    c = lookup(s, r/SPARSE_CHUNK, col/SPARSE_CHUNK);
+    return c ? (c->rows[r%SPARSE_CHUNK] >> (col%SPARSE_CHUNK)) & 1 : 0;
+}
+
+/* This function computes one candidate chunk of the next round.
+ * param c: the chunk in s->next, all dead
+ * returns its number of live cells */
+static long compute_chunk(struct sparse *s, struct chunk *c){
+    // rows -1..64 of the chunk, each a one-word row between its ghosts
+    uint64_t window[SPARSE_CHUNK + 2][3];
+    int height = chunk_span(c->cr, s->rows);
+    int width = chunk_span(c->cc, s->cols);
+    int r0 = c->cr*SPARSE_CHUNK, c0 = c->cc*SPARSE_CHUNK;
+    uint64_t mask = (width == 64) ? ~0ULL : (1ULL << width) - 1;
+    uint64_t changed = 0;
+    long live = 0;
+
+    //a column at a time, so that most reads hit the same chunk as the
+    //last one. The kernel only looks at the bit next to the row in the
+    //ghost words. Past the edge of a short chunk the row holds the cells
+    //from the other side of the board, which are that edge's neighbours.
+    for (int y = -1; y <= height; y++){
+        window[y + 1][1] = read_word(s, r0 + y, c0);
+    }
+    for (int y = -1; y <= height; y++){
+        window[y + 1][0] = read_cell(s, r0 + y, c0 - 1) << 63;
+    }
+    for (int y = -1; y <= height; y++){
+        window[y + 1][2] = read_cell(s, r0 + y, c0 + 64);
+    }
+    for (int y = 0; y < height; y++){
+        //a row with nothing alive around it stays dead
+        if (!(window[y][0] | window[y][1] | window[y][2] |
+                    window[y + 1][0] | window[y + 1][1] | window[y + 1][2] |
+                    window[y + 2][0] | window[y + 2][1] | window[y + 2][2])){
+            continue;
+        }
+        s->row(window[y] + 1, window[y + 1] + 1, window[y + 2] + 1,
+                &c->rows[y], 0, 0, 1, 64, &changed, NULL);
+        c->rows[y] &= mask;
+        live += __builtin_popcountll(c->rows[y]);
+    }
+    return live;
+}
+
+/* This function adds the chunks next to a live chunk that its edge cells
+ * can bring to life to the candidates. */
+static void add_neighbours(struct sparse *s, const struct chunk *c){
+    int height = chunk_span(c->cr, s->rows);
+    int width = chunk_span(c->cc, s->cols);
+    uint64_t first = 1, last = 1ULL << (width - 1);
+    uint64_t top = c->rows[0], bottom = c->rows[height - 1], sides = 0;
+    int up = (c->cr > 0) ? c->cr - 1 : s->chunk_rows - 1;
+    int down = (c->cr < s->chunk_rows - 1) ? c->cr + 1 : 0;
+    int left = (c->cc > 0) ? c->cc - 1 : s->chunk_cols - 1;
+    int right = (c->cc < s->chunk_cols - 1) ? c->cc + 1 : 0;
+
+    for (int y = 0; y < height; y++){
+        sides |= c->rows[y];
+    }
+    if (top){
+        table_add(&s->next, up, c->cc);
+    }
+    if (bottom){
+        table_add(&s->next, down, c->cc);
+    }
+    if (sides & first){
+        table_add(&s->next, c->cr, left);
+    }
+    if (sides & last){
+        table_add(&s->next, c->cr, right);
+    }
+    if (top & first){
+        table_add(&s->next, up, left);
+    }
+    if (top & last){
+        table_add(&s->next, up, right);
+    }
+    if (bottom & first){
+        table_add(&s->next, down, left);
+    }
+    if (bottom & last){
+        table_add(&s->next, down, right);
+    }
+}
+
+long sparse_step(struct sparse *s){
+    struct table swap;
+    struct chunk *c;
+    long live = 0, cells;
+    int kept = 0;
+
+    //the candidates: every live chunk and the neighbours it can reach
+    table_clear(&s->next);
+    for (int i = 0; i < s->now.count; i++){
+        table_add(&s->next, s->now.chunks[i].cr, s->now.chunks[i].cc);
+        add_neighbours(s, &s->now.chunks[i]);
+    }
+
+    s->last = NULL;
+    s->last_cr = s->last_cc = -1;
+    for (int i = 0; i < s->next.count; i++){
+        c = &s->next.chunks[i];
+        cells = compute_chunk(s, c);
+        //drop chunks that came out empty, packing the rest down
+        if (cells){
+            if (kept != i){
+                s->next.chunks[kept] = *c;
+            }
+            kept++;
+            live += cells;
+        }
+    }
+    s->next.count = kept;
+    memset(s->next.slots, 0, sizeof(int)*(s->next.mask + 1));
+    for (int i = 0; i < kept; i++){
+        *table_slot(&s->next, s->next.chunks[i].cr, s->next.chunks[i].cc) =
+            i + 1;
+    }
+
+    swap = s->now;
+    s->now = s->next;
+    s->next = swap;
+    s->live = live;
+    return live;
+}
@@ -0,0 +1,38 @@
+#ifndef __SPARSE_H__
+#define __SPARSE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "kernel.h"
+
+/* This file declares the sparse engine, for boards where only a tiny
+ * part of the cells are alive. It keeps only the 64x64 chunks of the
+ * board that hold live cells, in a hash table, and each round computes
+ * just those chunks and the chunks next to their live edges; the empty
+ * rest of the board costs nothing. */
+
+/* Rows and columns of cells in a chunk */
+#define SPARSE_CHUNK  (64)
+
+struct sparse;
+
+/* Makes an empty sparse board of rows x cols that wraps around at the
+ * edges, whose rounds are computed with the row kernel row. */
+struct sparse *sparse_create(int rows, int cols, row_kernel_fn row);
+void sparse_free(struct sparse *s);
+
+/* Copies the live cells of a packed board into s, which must be empty.
+ *   board: row r starts at board + r*stride; cell c of a row is bit c%64
+ *          of word c/64, and bits past the last column are 0 */
+void sparse_load(struct sparse *s, const uint64_t *board, size_t stride);
+
+/* Copies s back out to a packed board laid out as for sparse_load. Only
+ * words that differ are written, so the pages of a big, mostly empty
+ * board that were never touched stay that way. */
+void sparse_store(const struct sparse *s, uint64_t *board, size_t stride);
+
+/* Plays one round.
+ * returns the number of live cells after it */
+long sparse_step(struct sparse *s);
+
+#endif  /* __SPARSE_H__ */
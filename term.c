@@ -0,0 +1,332 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the terminal renderer (see term.h).
+ *
+ * A frame is first reduced to a glyph per character cell of the screen:
+ * a byte with a bit for each of the glyph's dots, set if the cells under
+ * that dot have a live one. Comparing that with the glyphs already on the
+ * screen says what to write. A run of changed glyphs is written after
+ * one cursor move; when two runs are only a few glyphs apart, writing the
+ * glyphs between them again is shorter than moving the cursor.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include "term.h"
+
+/* Longest cursor move, "\033[row;colH", and longest glyph, in bytes */
+#define CUP_MAX    (16)
+#define GLYPH_MAX  (3)
+
+/* Unchanged glyphs between two changed ones that are written again rather
+ * than moved over with the cursor */
+#define MAX_GAP    (4)
+
+/* Lines of the screen that aren't board: the round above it, and the
+ * line the cursor is left on below it */
+#define MARGIN     (2)
+
+static const struct glyph_shape {
+    const char *name;
+    int dot_w;      // dots across a glyph
+    int dot_h;      // dots down a glyph
+    int width;      // columns of the screen a glyph takes
+} shapes[TERM_FIT] = {
+    { "cells", 1, 1, 2 },
+    { "half", 1, 2, 1 },
+    { "braille", 2, 4, 1 },
+};
+
+/* The bit of a braille glyph for each dot, [down][across] */
+static const uint8_t braille_bits[4][2] = {
+    { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 },
+};
+
+struct term {
+    struct grid grid;
+    int fd;
+    int glyphs;         // TERM_CELLS, TERM_HALF or TERM_BRAILLE
+    int scale;          // a dot is scale x scale cells
+    int width;          // glyphs across the screen
+    int height;         // glyphs down the screen
+    uint8_t *shown;     // the glyphs on the screen, width*height
+    uint8_t *next;      // the glyphs of the frame being drawn
+    uint64_t *merged;   // scale rows of the board ORed together
+    char *buf;          // a whole frame of output
+    int drawn;          // frames drawn, shown holds the last one's
+};
+
+/* This function finds the glyphs called name.
+ * param name: cells, half, braille or fit
+ * returns TERM_CELLS, TERM_HALF, TERM_BRAILLE or TERM_FIT, or -1
+ */
+int term_glyphs(const char *name){
+    for (int i = 0; i < TERM_FIT; i++){
+        if (strcmp(name, shapes[i].name) == 0){
+            return i;
+        }
+    }
+    if (strcmp(name, "fit") == 0){
+        return TERM_FIT;
+    }
+    return -1;
+}
+
+/* This function finds the smallest scale that fits a board in an area of
+ * the screen with some glyphs.
+ * param g: the board's layout
+ * param glyphs: TERM_CELLS, TERM_HALF or TERM_BRAILLE
+ * param cols, lines: the size of the area, 0 for no limit
+ * returns the scale, or 0 if not even a glyph fits
+ */
+static int fit_scale(const struct grid *g, int glyphs, int cols, int lines){
+    const struct glyph_shape *s = &shapes[glyphs];
+    int across, down, scale;
+
+    if (cols <= 0 || lines <= 0){
+        return 1;
+    }
+    across = (cols/s->width)*s->dot_w;  // dots that fit
+    down = lines*s->dot_h;
+    if (across == 0){
+        return 0;
+    }
+    scale = (g->cols + across-1)/across;
+    if ((g->rows + down-1)/down > scale){
+        scale = (g->rows + down-1)/down;
+    }
+    return scale;
+}
+
+/* This function sets up to draw boards on a terminal.
+ * param g: the layout of the boards it will draw
+ * param glyphs: one of the TERM_ glyphs
+ * param fd: where the frames go
+ * returns the renderer
+ */
+struct term *term_open(const struct grid *g, int glyphs, int fd){
+    struct term *t = calloc(1, sizeof(struct term));
+    struct winsize ws;
+    int cols = 0, lines = 0, dots_across, dots_down;
+    size_t glyphs_on_screen;
+
+    if (!t){
+        perror("calloc: term");
+        exit(1);
+    }
+    if (isatty(fd) && ioctl(fd, TIOCGWINSZ, &ws) == 0 &&
+            ws.ws_row > MARGIN){
+        cols = ws.ws_col;
+        lines = ws.ws_row - MARGIN;
+    }
+
+    //pick the glyphs and how far to shrink the board; a terminal too
+    //narrow for even one glyph gets the board whole, to scroll through
+    if (glyphs == TERM_FIT){
+        glyphs = TERM_BRAILLE;
+        for (int i = 0; i < TERM_BRAILLE; i++){
+            if (fit_scale(g, i, cols, lines) == 1){
+                glyphs = i;
+                break;
+            }
+        }
+    }
+    t->scale = fit_scale(g, glyphs, cols, lines);
+    if (t->scale == 0){
+        t->scale = 1;
+    }
+
+    t->grid = *g;
+    t->fd = fd;
+    t->glyphs = glyphs;
+    dots_across = (g->cols + t->scale-1)/t->scale;
+    dots_down = (g->rows + t->scale-1)/t->scale;
+    t->width = (dots_across + shapes[glyphs].dot_w-1)/shapes[glyphs].dot_w;
+    t->height = (dots_down + shapes[glyphs].dot_h-1)/shapes[glyphs].dot_h;
+
+    //at worst every glyph is changed and every other one needs a
+    //cursor move
+    glyphs_on_screen = (size_t)t->width*t->height;
+    t->shown = malloc(glyphs_on_screen);
+    t->next = malloc(glyphs_on_screen);
+    t->merged = malloc(sizeof(uint64_t)*g->words);
+    t->buf = malloc(128 + glyphs_on_screen*(CUP_MAX + GLYPH_MAX) +
+            (size_t)t->height*CUP_MAX);
+    if (!t->shown || !t->next || !t->merged || !t->buf){
+        perror("malloc: term");
+        exit(1);
+    }
+    return t;
+}
+
+/* This function works out the glyphs of a board into t->next.
+ * param t: the renderer
+ * param cells: the board
+ */
+static void make_glyphs(struct term *t, uint64_t *cells){
+    const struct glyph_shape *s = &shapes[t->glyphs];
+    const struct grid *g = &t->grid;
+    const uint64_t *row;
+    uint8_t *line, bit;
+    int r, dot, c, x;
+
+    memset(t->next, 0, (size_t)t->width*t->height);
+    for (r = 0; r < g->rows; r += t->scale){
+        //a row of dots stands for scale rows of the board
+        row = grid_row(g, cells, r);
+        if (t->scale > 1){
+            memcpy(t->merged, row, sizeof(uint64_t)*g->words);
+            for (int i = 1; i < t->scale && r+i < g->rows; i++){
+                row = grid_row(g, cells, r+i);
+                for (int k = 0; k < g->words; k++){
+                    t->merged[k] |= row[k];
+                }
+            }
+            row = t->merged;
+        }
+
+        dot = r/t->scale;
+        line = t->next + (size_t)(dot/s->dot_h)*t->width;
+        //once a dot is set, the rest of its cells don't matter
+        for (c = grid_next_live(g, row, 0); c < g->cols;
+                c = grid_next_live(g, row, (x+1)*t->scale)){
+            x = c/t->scale;
+            if (t->glyphs == TERM_BRAILLE){
+                bit = braille_bits[dot%4][x%2];
+            } else {
+                bit = 1 << (dot % s->dot_h);
+            }
+            line[x/s->dot_w] |= bit;
+        }
+    }
+}
+
+/* This function writes a glyph.
+ * param t: the renderer
+ * param p: where to write it
+ * param glyph: the glyph's dots
+ * returns the end of what was written
+ */
+static char *put_glyph(struct term *t, char *p, uint8_t glyph){
+    switch (t->glyphs){
+        case TERM_CELLS:
+            *p++ = ' ';
+            *p++ = glyph ? '@' : '.';
+            break;
+        case TERM_HALF:
+            //U+2580 upper half, U+2584 lower half, U+2588 full block
+            if (glyph == 0){
+                *p++ = ' ';
+            } else {
+                *p++ = (char)0xe2;
+                *p++ = (char)0x96;
+                *p++ = (char)(glyph == 1 ? 0x80 : glyph == 2 ? 0x84 : 0x88);
+            }
+            break;
+        default:
+            //U+2800 plus the dots
+            if (glyph == 0){
+                *p++ = ' ';
+            } else {
+                *p++ = (char)0xe2;
+                *p++ = (char)(0xa0 | (glyph >> 6));
+                *p++ = (char)(0x80 | (glyph & 0x3f));
+            }
+            break;
+    }
+    return p;
+}
+
+/* This function writes all of a buffer, however many writes it takes.
+ * param fd: where to
+ * param buf, len: what to write
+ */
+static void write_all(int fd, const char *buf, size_t len){
+    ssize_t n;
+
+    while (len > 0){
+        n = write(fd, buf, len);
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            perror("write: frame");
+            exit(1);
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+/* This function draws a board, writing only the glyphs that changed.
+ * param t: the renderer
+ * param cells: the board
+ * param round: rounds played, shown above the board
+ * param live: live cells on the board, shown above the board
+ */
+void term_draw(struct term *t, uint64_t *cells, int round, int live){
+    int cw = shapes[t->glyphs].width;
+    char *p = t->buf;
+    uint8_t *swap;
+    int i, x, y, at;
+
+    make_glyphs(t, cells);
+
+    //the first frame starts on a clear screen, with the cursor hidden
+    if (t->drawn == 0){
+        p += sprintf(p, "\033[?25l\033[H\033[2J");
+    }
+    p += sprintf(p, "\033[HRound: %d  Live cells: %d", round, live);
+    if (t->scale > 1){
+        p += sprintf(p, "  (%dx%d cells per dot)", t->scale, t->scale);
+    }
+    p += sprintf(p, "\033[K");
+
+    for (y = 0; y < t->height; y++){
+        at = -1;    // the glyph the cursor is on, -1 if not in this line
+        for (x = 0; x < t->width; x++){
+            i = y*t->width + x;
+            if (t->drawn > 0 && t->next[i] == t->shown[i]){
+                continue;
+            }
+            if (at >= 0 && x - at <= MAX_GAP){
+                for (; at < x; at++){
+                    p = put_glyph(t, p, t->next[y*t->width + at]);
+                }
+            } else {
+                p += sprintf(p, "\033[%d;%dH", y+2, x*cw + 1);
+            }
+            p = put_glyph(t, p, t->next[i]);
+            at = x+1;
+        }
+    }
+    p += sprintf(p, "\033[%d;1H", t->height+2);
+    write_all(t->fd, t->buf, p - t->buf);
+
+    swap = t->shown;
+    t->shown = t->next;
+    t->next = swap;
+    t->drawn++;
+}
+
+/* This function shows the cursor again, under the board, and frees the
+ * renderer.
+ * param t: the renderer
+ */
+void term_close(struct term *t){
+    if (t->drawn > 0){
+        write_all(t->fd, "\033[?25h", 6);
+    }
+    free(t->shown);
+    free(t->next);
+    free(t->merged);
+    free(t->buf);
+    free(t);
+}
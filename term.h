@@ -0,0 +1,44 @@
+#ifndef __TERM_H__
+#define __TERM_H__
+
+#include <stdint.h>
+#include "grid.h"
+
+/* This file declares the terminal renderer that output mode 1 draws the
+ * board with. Each frame is built in one buffer allocated up front and
+ * goes out in one write: the round and live count on the first line,
+ * then, using ANSI cursor positioning, only the parts of the board that
+ * look different from the frame before. Nothing is cleared between
+ * frames, so a board that hardly changes costs hardly anything to draw.
+ *
+ * The board is drawn with one of these glyphs:
+ *   - TERM_CELLS: " @" or " ." for each cell, as print_board does
+ *   - TERM_HALF: Unicode half blocks, one for 1x2 cells
+ *   - TERM_BRAILLE: Unicode braille, one for 2x4 cells
+ * or TERM_FIT, the first of them that lets the board fit in the terminal.
+ * A board that still doesn't fit is shrunk: each dot of a glyph then
+ * stands for a square of cells, and is set if any of them is alive. */
+
+#define TERM_CELLS    (0)
+#define TERM_HALF     (1)
+#define TERM_BRAILLE  (2)
+#define TERM_FIT      (3)
+
+struct term;
+
+/* returns the TERM_ glyphs called name (cells, half, braille or fit), or
+ * -1 if there are none called that */
+int term_glyphs(const char *name);
+
+/* Sets up to draw boards laid out as g on the terminal at fd with
+ * glyphs. If fd is not a terminal, or its size can't be had, the board
+ * is drawn whole, and TERM_FIT draws with TERM_CELLS. */
+struct term *term_open(const struct grid *g, int glyphs, int fd);
+
+/* Draws a board: round and live are shown above it. */
+void term_draw(struct term *t, uint64_t *cells, int round, int live);
+
+/* Leaves the cursor under the last board drawn and frees t. */
+void term_close(struct term *t);
+
+#endif  /* __TERM_H__ */
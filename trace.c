@@ -0,0 +1,205 @@
+/*
+ * Swarthmore College, CS 31
+ * Copyright (c) 2023 Swarthmore College Computer Science Department,
+ * Swarthmore PA
+ */
+
+/* This file implements the per-thread timing trace (see trace.h).
+ *
+ * Times come from the monotonic clock, which Linux reads without a
+ * system call, so a mark costs a few tens of nanoseconds. Each thread
+ * writes only its own cache-aligned slot and ring, so marking needs no
+ * locks; the rings are read after the game, once the threads are done.
+ */
+#ifdef GOL_TRACE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "trace.h"
+
+/* One span of one thread's time */
+struct trace_span {
+    uint64_t start;     // ns since trace_init
+    uint64_t length;    // ns
+    long cells;         // cells updated in the span
+    int round;
+    int kind;
+};
+
+/* One thread's trace */
+struct trace_thread {
+    uint64_t last;                  // when the current span started
+    long cells;                     // cells so far in the current span
+    struct trace_span *ring;
+    long spans;                     // spans recorded, over the whole run
+    uint64_t total[TRACE_KINDS];    // ns spent on each kind of span
+    uint64_t longest[TRACE_KINDS];  // longest span of each kind
+    long count[TRACE_KINDS];        // number of spans of each kind
+    long total_cells;
+} __attribute__((aligned(64)));
+
+static const char *kind_names[TRACE_KINDS] = {
+    "compute", "barrier", "serial", "output"
+};
+
+static struct trace_thread *threads_trace;
+static int num_threads;
+static uint64_t epoch;
+
+static inline uint64_t now_ns(void){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+/* This function sets up an empty ring for each thread.
+ * param threads: number of threads */
+void trace_init(int threads){
+    threads_trace = aligned_alloc(64, sizeof(struct trace_thread)*threads);
+    if (!threads_trace){
+        perror("aligned_alloc: trace");
+        exit(1);
+    }
+    for (int i = 0; i < threads; i++){
+        threads_trace[i] = (struct trace_thread){0};
+        threads_trace[i].ring = malloc(sizeof(struct trace_span)*TRACE_RING);
+        if (!threads_trace[i].ring){
+            perror("malloc: trace ring");
+            exit(1);
+        }
+    }
+    num_threads = threads;
+    epoch = now_ns();
+}
+
+void trace_start(int thread){
+    if (!threads_trace){
+        return;
+    }
+    threads_trace[thread].last = now_ns();
+    threads_trace[thread].cells = 0;
+}
+
+void trace_cells(int thread, long cells){
+    if (!threads_trace){
+        return;
+    }
+    threads_trace[thread].cells += cells;
+}
+
+/* This function records the span from the thread's last mark to now.
+ * param thread: the thread's id
+ * param kind: what the thread was doing, one of the TRACE_ kinds
+ * param round: the round it was doing it for */
+void trace_mark(int thread, int kind, int round){
+    struct trace_thread *t;
+    struct trace_span *span;
+    uint64_t time;
+
+    if (!threads_trace){
+        return;
+    }
+    t = &threads_trace[thread];
+    span = &t->ring[t->spans % TRACE_RING];
+    time = now_ns();
+
+    span->start = t->last - epoch;
+    span->length = time - t->last;
+    span->cells = t->cells;
+    span->round = round;
+    span->kind = kind;
+    t->spans++;
+
+    t->total[kind] += span->length;
+    t->count[kind]++;
+    if (span->length > t->longest[kind]){
+        t->longest[kind] = span->length;
+    }
+    t->total_cells += t->cells;
+    t->cells = 0;
+    t->last = time;
+}
+
+/* This function prints where each thread's time went: the total and
+ * longest span of each kind, and the thread's cells per second of
+ * compute. */
+static void print_summary(void){
+    struct trace_thread *t;
+    uint64_t all;
+
+    printf("\nTrace (ms, with the share of the thread's time, and the"\
+            " longest span):\n");
+    printf("%6s %22s %22s %22s %22s %12s\n", "thread", "compute",
+            "barrier", "serial", "output", "cells/s");
+    for (int i = 0; i < num_threads; i++){
+        t = &threads_trace[i];
+        all = 0;
+        for (int k = 0; k < TRACE_KINDS; k++){
+            all += t->total[k];
+        }
+        all = (all > 0) ? all : 1;
+        printf("%6d", i);
+        for (int k = 0; k < TRACE_KINDS; k++){
+            printf(" %9.2f %4.1f%% %6.3f", t->total[k]/1e6,
+                    100.0*t->total[k]/all, t->longest[k]/1e6);
+        }
+        printf(" %12.4g\n", (t->total[TRACE_COMPUTE] > 0) ?
+                t->total_cells/(t->total[TRACE_COMPUTE]/1e9) : 0.0);
+    }
+}
+
+/* This function writes the spans still in the rings as a Chrome trace:
+ * one complete ("X") event per span, with each thread on its own line. */
+static void write_chrome(const char *path){
+    FILE *out = fopen(path, "w");
+    struct trace_thread *t;
+    struct trace_span *span;
+    long first;
+    int comma = 0;
+
+    if (!out){
+        printf("Error: failed to open file: %s\n", path);
+        return;
+    }
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    for (int i = 0; i < num_threads; i++){
+        t = &threads_trace[i];
+        fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", "\
+                "\"pid\": 1, \"tid\": %d, \"args\": {\"name\": "\
+                "\"thread %d\"}}", comma ? ",\n" : "", i, i);
+        comma = 1;
+        first = (t->spans > TRACE_RING) ? t->spans - TRACE_RING : 0;
+        for (long n = first; n < t->spans; n++){
+            span = &t->ring[n % TRACE_RING];
+            fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", "\
+                    "\"pid\": 1, \"tid\": %d, \"ts\": %.3f, "\
+                    "\"dur\": %.3f, \"args\": {\"round\": %d, "\
+                    "\"cells\": %ld}}", kind_names[span->kind], i,
+                    span->start/1e3, span->length/1e3, span->round,
+                    span->cells);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    printf("Trace written to %s\n", path);
+}
+
+void trace_finish(void){
+    const char *path = getenv("GOL_TRACE_FILE");
+
+    if (!threads_trace){
+        return;
+    }
+    print_summary();
+    write_chrome(path ? path : TRACE_FILE);
+    for (int i = 0; i < num_threads; i++){
+        free(threads_trace[i].ring);
+    }
+    free(threads_trace);
+    threads_trace = NULL;
+}
+
+#endif  /* GOL_TRACE */
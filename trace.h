@@ -0,0 +1,67 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/* This file declares the per-thread timing trace, which shows where each
+ * thread's time goes round by round: updating cells, waiting at the
+ * barrier, or working alone as thread 0. It is only built in when the
+ * program is compiled with GOL_TRACE defined (make TRACE=1); otherwise
+ * every TRACE_ macro below is empty and costs nothing.
+ *
+ * Each thread has a ring buffer of spans. A thread calls TRACE_START
+ * once, then TRACE_MARK each time it finishes something: the span from
+ * its last mark to now is recorded as that kind of work. At exit,
+ * TRACE_FINISH prints a summary per thread and writes every span in the
+ * rings as a Chrome trace (chrome://tracing or ui.perfetto.dev) to
+ * $GOL_TRACE_FILE, or to TRACE_FILE if that isn't set. */
+
+/* Kinds of spans */
+#define TRACE_COMPUTE  (0)   // updating cells (update_cells)
+#define TRACE_BARRIER  (1)   // waiting for the other threads
+#define TRACE_SERIAL   (2)   // thread 0 adding up the round, snapshots
+#define TRACE_OUTPUT   (3)   // printing, drawing and animation delays
+#define TRACE_KINDS    (4)
+
+/* Spans kept per thread; older ones are overwritten (but still counted
+ * in the summary) */
+#define TRACE_RING     (1 << 16)
+
+#define TRACE_FILE     "gol_trace.json"
+
+#ifdef GOL_TRACE
+
+/* Sets up the rings for threads threads. */
+void trace_init(int threads);
+
+/* Starts thread's first span. This and the two below do nothing if
+ * trace_init hasn't been called, so a game played without it (by a
+ * caller other than main and gol_bench_run) just isn't traced. */
+void trace_start(int thread);
+
+/* Adds cells to the count of cells thread has updated in its current
+ * span. */
+void trace_cells(int thread, long cells);
+
+/* Ends thread's current span as kind, during round round, and starts
+ * the next one. */
+void trace_mark(int thread, int kind, int round);
+
+/* Prints the summary, writes the Chrome trace and frees the rings. */
+void trace_finish(void);
+
+#define TRACE_INIT(threads)              trace_init(threads)
+#define TRACE_START(thread)              trace_start(thread)
+#define TRACE_CELLS(thread, cells)       trace_cells(thread, cells)
+#define TRACE_MARK(thread, kind, round)  trace_mark(thread, kind, round)
+#define TRACE_FINISH()                   trace_finish()
+
+#else
+
+#define TRACE_INIT(threads)              ((void)0)
+#define TRACE_START(thread)              ((void)0)
+#define TRACE_CELLS(thread, cells)       ((void)0)
+#define TRACE_MARK(thread, kind, round)  ((void)0)
+#define TRACE_FINISH()                   ((void)0)
+
+#endif  /* GOL_TRACE */
+
+#endif  /* __TRACE_H__ */